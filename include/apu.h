@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include "blip_buffer.h"
+#include "scheduler.h"
+
+constexpr double   GB_CLOCK_RATE = 4194304.0;   // T-cycles per second
+constexpr uint64_t APU_SEQUENCER_CYCLES = 2048; // M-cycles per 512 Hz frame sequencer step
+
+/*
+ * AudioCallback - Receives a block of interleaved stereo int16 samples.
+ * @samples: left/right pairs.
+ * @frames:  the number of pairs.
+ */
+using AudioCallback = std::function<void(const int16_t *samples, size_t frames)>;
+
+struct ChannelState {
+    uint8_t  ENABLED = 0;
+    uint8_t  VOLUME = 0;            // Envelope volume (square/noise)
+    uint8_t  ENVELOPE_TIMER = 0;
+    uint8_t  POSITION = 0;          // Duty step (square) or sample index (wave)
+    uint16_t LENGTH = 0;            // Remaining length counter
+    uint16_t LFSR = 0;              // Noise shift register
+    uint64_t NEXT_EDGE = 0;         // T-cycle of the next waveform timer expiry
+};
+
+struct APUState {
+    uint8_t  REGS[0x30] = {0};      // 0xFF10-0xFF3F as written, wave RAM included
+    ChannelState CH[4];
+    uint8_t  SEQUENCER_STEP = 0;
+    uint8_t  SWEEP_ENABLED = 0;
+    uint8_t  SWEEP_TIMER = 0;
+    uint8_t  RESERVED0[1] = {};
+    uint16_t SWEEP_SHADOW = 0;
+    uint8_t  RESERVED1[2] = {};
+    uint64_t TIME = 0;              // T-cycle the waveforms were last advanced to
+};
+
+/*
+ * APU - DMG audio processing unit: two square channels, wave, noise and the frame sequencer.
+ *
+ * Nothing runs per cycle. Channel waveforms are advanced in one batch up to the current time
+ * whenever a register is written or the frame sequencer fires, and every amplitude change is
+ * handed to a band-limited BlipBuffer. Completed blocks go to the audio callback eight times per
+ * frame sequencer cycle (64 Hz).
+ *
+ * With synthesis disabled only the frame sequencer state (length, envelope, sweep and the channel
+ * enable bits) is maintained: waveforms are never advanced and no sample is produced.
+ *
+ * Reference: https://gbdev.io/pandocs/Audio.html
+ */
+class APU {
+public:
+    APU(Scheduler *scheduler, double sample_rate = 48000);
+
+    uint8_t read_register(uint16_t address);
+    void    write_register(uint16_t address, uint8_t data, uint64_t now);
+    void    on_event(uint64_t now);
+
+    void set_sample_rate(double sample_rate);
+    double get_sample_rate() const { return m_sample_rate; }
+
+    void set_synthesis(bool enabled);
+    bool is_synthesis_enabled() const { return m_synthesis; }
+    void resync();
+    void suspend();
+    void resume();
+
+    /*
+     * set_audio_callback - Sets the function receiving synthesized samples, or nullptr.
+     * @callback: the function to call on the emulation thread.
+     */
+    void set_audio_callback(AudioCallback callback) { m_audio_callback = std::move(callback); }
+
+    APUState &get_state() { return m_state; }
+
+private:
+    APUState m_state;
+    Scheduler *m_scheduler;
+
+    bool   m_synthesis = true;
+    bool   m_suspended = false;     // Synthesis was on when suspend() was called
+    double m_sample_rate;
+    BlipBuffer m_left;
+    BlipBuffer m_right;
+    uint64_t m_frame_start = 0;     // T-cycle of the current blip frame's start
+    int32_t  m_output[4][2] = {};   // Last amplitude handed to the blip buffers, per channel/side
+    AudioCallback m_audio_callback;
+
+    void catch_up(uint64_t time);
+    void update_outputs(uint64_t time);
+    void update_output(int channel, uint64_t time);
+    int  amplitude(int channel) const;
+    void trigger(int channel, uint64_t time);
+    void power_off();
+    void deliver();
+
+    void clock_length();
+    void clock_envelope();
+    void clock_sweep();
+    uint16_t sweep_target();
+
+    bool     dac_enabled(int channel) const;
+    uint16_t frequency(int channel) const;
+    uint64_t period(int channel) const;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "spsc_queue.h"
+
+enum class AudioFileFormat {
+    WAV,            // 16-bit stereo PCM with a RIFF header
+    RAW,            // Headerless interleaved little-endian int16
+};
+
+/*
+ * AudioDump - Records interleaved stereo int16 samples to a WAV or raw PCM file.
+ *
+ * write() only copies into a fixed pool of large chunks; full chunks are handed to a writer
+ * thread over an SPSC queue and come back over another once written, so the emulation thread
+ * never touches the file. It only waits when every chunk is still queued for the disk, since a
+ * dump with holes would be useless for fingerprinting. A failed write is reported by close().
+ */
+class AudioDump {
+public:
+    static constexpr size_t CHUNK_FRAMES = 16384;
+    static constexpr size_t CHUNK_COUNT  = 16;
+
+    AudioDump() {};
+    ~AudioDump();
+
+    bool open(const std::string &filename, AudioFileFormat format, uint32_t sample_rate);
+    void write(const int16_t *samples, size_t frames);
+    bool close();
+
+    bool is_open() const { return m_file.is_open(); }
+    uint64_t get_frames() const { return m_frames; }
+    uint64_t get_stalls() const { return m_stalls; }
+
+private:
+    struct Chunk {
+        int16_t samples[CHUNK_FRAMES * 2];
+        size_t  frames;
+    };
+
+    std::ofstream   m_file;
+    AudioFileFormat m_format = AudioFileFormat::RAW;
+    uint32_t        m_sample_rate = 0;
+    uint64_t        m_frames = 0;           // Frames passed to write()
+    uint64_t        m_stalls = 0;           // Times write() waited for a free chunk
+    bool            m_failed = false;       // A write failed; set by the writer, read once it is joined
+
+    std::unique_ptr<Chunk[]> m_chunks;
+    SPSCQueue<uint32_t, CHUNK_COUNT> m_full;   // Emulation thread -> writer
+    SPSCQueue<uint32_t, CHUNK_COUNT> m_free;   // Writer -> emulation thread
+    Chunk *m_current = nullptr;
+    uint32_t m_current_index = 0;
+
+    std::atomic<bool> m_running {false};
+    std::thread m_thread;
+
+    void run();
+    void submit();
+    void write_header();
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "resampler.h"
+#include "spsc_queue.h"
+
+/*
+ * AudioOutput - Hands APU samples to a host audio thread at the host's rate.
+ *
+ * The emulation thread resamples each block and appends it to a lock-free SPSC ring with
+ * write(); the sink thread drains it with read(). Neither side ever waits: a full ring drops the
+ * newest samples and an empty one is padded with silence, and both are counted. The ring holds
+ * interleaved samples and both sides always move whole pairs, so it never splits a pair.
+ *
+ * In real-time sessions the emulation is paced by video while the sink is paced by the audio
+ * device's clock, and the two never agree exactly. With rate control on, every write() nudges
+ * the resampling ratio by at most a fraction of a percent, inaudibly, in the direction that
+ * brings the fill level back to the target, so a small ring neither drains nor overflows.
+ *
+ * Reference: H. K. Arntzen, "Dynamic Rate Control for Retro Game Emulators" (2012)
+ */
+class AudioOutput {
+public:
+    static constexpr size_t RING_SAMPLES = 1 << 15;
+
+    AudioOutput(double input_rate, double output_rate);
+
+    void   write(const int16_t *samples, size_t frames);
+    size_t read(int16_t *out, size_t frames);
+
+    /*
+     * fill_level - Sample pairs waiting in the ring. Exact from either side's thread.
+     */
+    size_t fill_level() const { return m_ring.size() / 2; }
+    static constexpr size_t capacity() { return RING_SAMPLES / 2; }
+
+    void set_rate_control(bool enabled, double max_deviation = 0.005);
+    void set_target_fill(size_t frames) { m_target_fill = frames; }
+    size_t get_target_fill() const { return m_target_fill; }
+
+    uint64_t get_dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t get_underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+
+    Resampler &get_resampler() { return m_resampler; }
+
+private:
+    Resampler m_resampler;
+    std::vector<int16_t> m_scratch;
+    bool   m_rate_control = false;
+    double m_max_deviation = 0;
+    size_t m_target_fill = capacity() / 4;
+    SPSCQueue<int16_t, RING_SAMPLES> m_ring;
+    std::atomic<uint64_t> m_dropped {0};     // Pairs lost to a full ring
+    std::atomic<uint64_t> m_underruns {0};   // Pairs of silence padded into read()
+};
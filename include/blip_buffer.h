@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * BlipBuffer - Band-limited step synthesis.
+ *
+ * Sources report amplitude changes (deltas) at exact clock times instead of producing a sample
+ * per clock. Each delta is spread over a few output samples with a windowed-sinc step kernel
+ * picked by its sub-sample phase, and read_samples() integrates the result. The cost scales with
+ * the number of amplitude changes, not with the clock rate, and the output has no aliasing from
+ * the square edges.
+ *
+ * Reference: http://www.slack.net/~ant/bl-synth/
+ */
+class BlipBuffer {
+public:
+    static constexpr int KERNEL_TAPS = 16;
+    static constexpr int PHASE_BITS  = 5;
+    static constexpr int PHASES      = 1 << PHASE_BITS;
+
+    BlipBuffer(double clock_rate, double sample_rate, size_t capacity = 4096);
+
+    void set_rates(double clock_rate, double sample_rate);
+    void clear();
+
+    /*
+     * add_delta - Adds an amplitude change.
+     * @time:  the clock at which it happens, relative to the start of the current frame.
+     * @delta: the change in output amplitude, in output sample units.
+     */
+    void add_delta(uint64_t time, int32_t delta) {
+        uint64_t position = m_offset + time * m_factor;
+        size_t index = m_avail + (position >> 32);
+        if (index + KERNEL_TAPS > m_buffer.size()) {
+            return;  // Reader fell a whole buffer behind; drop rather than overflow
+        }
+        const int16_t *kernel = m_kernel[(position >> (32 - PHASE_BITS)) & (PHASES - 1)];
+        int32_t *out = &m_buffer[index];
+        for (int i = 0; i < KERNEL_TAPS; i++) {
+            out[i] += delta * kernel[i];
+        }
+    }
+
+    void   end_frame(uint64_t time);
+    size_t samples_avail() const { return m_avail; }
+    size_t read_samples(int16_t *out, size_t count, size_t stride = 1);
+
+private:
+    uint64_t m_factor = 0;      // output samples per clock, 32.32 fixed point
+    uint64_t m_offset = 0;      // sub-sample position of the frame start, 32.32 fixed point
+    size_t   m_avail = 0;
+    int32_t  m_integrator = 0;
+    std::vector<int32_t> m_buffer;
+    int16_t  m_kernel[PHASES][KERNEL_TAPS];
+};
@@ -2,33 +2,127 @@
 
 #include <cstdint>
 #include <memory>
+#include "apu.h"
+#include "cpu_state.h"
+#include "dma.h"
+#include "hram.h"
+#include "io.h"
+#include "joypad.h"
+#include "oam.h"
+#include "ppu.h"
 #include "rom.h"
+#include "scheduler.h"
+#include "serial.h"
+#include "snapshot.h"
+#include "timer.h"
+#include "vram.h"
+#include "wram.h"
+
+/*
+ * DirtyPages - The 256-byte pages of each RAM written since some point, one bit per page.
+ */
+struct DirtyPages {
+    uint32_t WRAM = 0;
+    uint32_t VRAM = 0;
+    uint32_t ERAM = 0;
+    uint32_t HRAM = 0;      // Bit 0 only, HRAM is less than a page
+};
 
 /* Reference: https://gbdev.io/pandocs/Memory_Map.html */
 class Bus {
 public:
     Bus();
-    Bus(ROM *cartridge) : m_cartridge(cartridge) {}
+    Bus(ROM *cartridge);
 
     uint8_t  read_n8(uint16_t address);
     uint16_t read_n16(uint16_t address);
     void     write_n8(uint16_t address, uint8_t data);
     void     write_n16(uint16_t address, uint16_t data);
 
-    ROM      *get_cartridge();
-//    IO       *get_io();
-//    OAM      *get_oam();
-//    PPU      *get_ppu();
-//    VRAM     *get_vram();
-//    WRAM     *get_wram();
-//    HRAM     *get_hram();
+    /*
+     * connect - Attaches the CPU state that provides the clock and the IF/IE registers.
+     * @state: the CPU state.
+     */
+    void connect(CPUState *state) { m_cpu = state; }
+
+    /*
+     * tick - Dispatches every scheduler event that is due at the current M-cycle.
+     */
+    void tick() {
+        if (m_cpu->MCYCLES >= m_scheduler.next()) {
+            run_events();
+        }
+    }
+
+    /*
+     * stall - Holds the CPU off the bus for @cycles M-cycles once its current instruction ends.
+     * @cycles: the number of M-cycles.
+     */
+    void stall(uint16_t cycles) { m_cpu->STALL += cycles; }
+
+    uint8_t *get_page(uint16_t address);
+
+    void *get_section(Section section);
+    void  save_snapshot(Snapshot &snapshot);
+    void  update_snapshot(Snapshot &snapshot);
+    void  load_snapshot(const Snapshot &snapshot);
+    void  revert_snapshot(const Snapshot &snapshot);
+    void  restore_section(Section section, const void *data, size_t size);
+    void  finish_restore();
+
+    /*
+     * set_buttons - Replaces the set of held joypad buttons.
+     * @buttons: a mask of Button.
+     */
+    void set_buttons(uint8_t buttons) { m_joypad->set_buttons(buttons, m_cpu->IF); }
+
+    void mark_dirty(uint16_t address, size_t length);
+    const DirtyPages &get_dirty_pages() const { return m_dirty; }
+    DirtyPages take_written_pages();
+
+    APU       *get_apu();
+    ROM       *get_cartridge();
+    DMA       *get_dma();
+    IO        *get_io();
+    Joypad    *get_joypad();
+    OAM       *get_oam();
+    PPU       *get_ppu();
+    VRAM      *get_vram();
+    WRAM      *get_wram();
+    HRAM      *get_hram();
+    Serial    *get_serial();
+    Timer     *get_timer();
+    Scheduler *get_scheduler();
 
 private:
     std::unique_ptr<ROM>       m_cartridge;
-//    std::unique_ptr<PPU>       m_ppu;
-//    std::unique_ptr<WRAM>      m_wram;
-//    std::unique_ptr<VRAM>      m_vram;
-//    std::unique_ptr<OAM>       m_oam;
-//    std::unique_ptr<IO>        m_io;
-//    std::unique_ptr<HRAM>      m_hram;
+    std::unique_ptr<WRAM>      m_wram;
+    std::unique_ptr<VRAM>      m_vram;
+    std::unique_ptr<OAM>       m_oam;
+    std::unique_ptr<IO>        m_io;
+    std::unique_ptr<Joypad>    m_joypad;
+    std::unique_ptr<HRAM>      m_hram;
+    std::unique_ptr<PPU>       m_ppu;
+    std::unique_ptr<APU>       m_apu;
+    std::unique_ptr<Timer>     m_timer;
+    std::unique_ptr<Serial>    m_serial;
+    std::unique_ptr<DMA>       m_dma;
+    Scheduler                  m_scheduler;
+
+    CPUState  m_detached;            // Clock and IF/IE until a CPU connects
+    CPUState *m_cpu = &m_detached;
+
+    DirtyPages      m_dirty;                 // Written since the last snapshot
+    const Snapshot *m_dirty_base = nullptr;  // The snapshot that matches memory but for m_dirty
+    DirtyPages      m_written;               // Written since the last take_written_pages()
+
+    void init();
+    void run_events();
+    void copy_dirty(uint8_t *snapshot, bool save);
+
+    void mark_page(uint32_t DirtyPages::*region, uint16_t address) {
+        uint32_t page = 1u << ((address >> 8) & 0x1F);
+        m_dirty.*region |= page;
+        m_written.*region |= page;
+    }
 };
@@ -1,41 +1,10 @@
+#pragma once
+
 #include <stdint.h>
+#include <functional>
+#include "cpu_state.h"
 #include "bus.h"
 
-union Register {
-    uint16_t r16;
-    struct {
-        uint8_t lo;
-        uint8_t hi;
-    } r8;
-};
-
-union CPUFlags {
-    uint8_t flags;
-    struct {
-        uint8_t c : 1; // Carry
-        uint8_t h : 1; // Half Carry
-        uint8_t n : 1; // Subtract
-        uint8_t z : 1; // Zero
-        uint8_t unused : 4;
-    } bits;
-};
-
-struct CPUState {
-    Register AF {0};
-    Register BC {0};
-    Register DE {0};
-    Register HL {0};
-    Register SP {0};
-    Register PC {0};
-    CPUFlags FLAGS {0};
-
-    uint8_t  IME = 0;
-    uint8_t  IF = 0;
-    uint8_t  IE = 0;
-
-    uint64_t MCYCLES = 0;
-};
-
 /*
  * CPU - GB SM83 CPU class
  *
@@ -47,20 +16,35 @@ class CPU {
 public:
     friend class TestCPU;  // For testing of private methods.
 
-    CPU() { m_bus = std::make_unique<Bus>(); }
-    CPU(Bus *bus) : m_bus(bus) {}
+    CPU() { m_bus = std::make_unique<Bus>(); m_bus->connect(&m_state); }
+    CPU(Bus *bus) : m_bus(bus) { m_bus->connect(&m_state); }
 
     void step();
     void reset();
     void set_state(const CPUState &state) { m_state = state; }
 
     CPUState &get_state() { return m_state; }
+    Bus *get_bus() { return m_bus.get(); }
     uint8_t fetch();
 
+    /*
+     * set_breakpoint_hook - Sets the function called after every LD B,B (0x40), the software
+     *                       breakpoint test ROMs and debuggers use, or nullptr.
+     * @hook: the function to call with the CPU state.
+     */
+    void set_breakpoint_hook(std::function<void(CPUState &)> hook) { m_breakpoint_hook = std::move(hook); }
+
+    /*
+     * get_stuck_reason - Why the CPU can provably never make progress again, or nullptr.
+     */
+    const char *get_stuck_reason() const;
+
 private:
     CPUState m_state;
     std::unique_ptr<Bus> m_bus;
-    uint8_t m_cycles_to_wait = 0;
+    std::function<void(CPUState &)> m_breakpoint_hook;
+
+    bool service_interrupts();
 
     /**
      * get_register_ref_r8 - Gets the 8-bit register pointer from an opcode that includes an 8-bit register.
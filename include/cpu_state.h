@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+union Register {
+    uint16_t r16;
+    struct {
+        uint8_t lo;
+        uint8_t hi;
+    } r8;
+};
+
+union CPUFlags {
+    uint8_t flags;
+    struct {
+        uint8_t c : 1; // Carry
+        uint8_t h : 1; // Half Carry
+        uint8_t n : 1; // Subtract
+        uint8_t z : 1; // Zero
+        uint8_t unused : 4;
+    } bits;
+};
+
+/* Why the CPU can provably never make progress again, see CPU::get_stuck_reason() */
+enum StuckReason : uint8_t {
+    STUCK_NONE = 0,
+    STUCK_JR_LOOP,          // JR to itself with interrupts disabled
+    STUCK_HALT,             // HALT with every interrupt disabled in IE
+};
+
+struct CPUState {
+    Register AF {0};
+    Register BC {0};
+    Register DE {0};
+    Register HL {0};
+    Register SP {0};
+    Register PC {0};
+    CPUFlags FLAGS {0};
+
+    uint8_t  IME = 0;
+    uint8_t  IF = 0;
+    uint8_t  IE = 0;
+
+    uint16_t STALL = 0;             // M-cycles the CPU is held off the bus after this instruction
+    uint16_t WAIT = 0;              // M-cycles left until the next instruction is fetched
+    uint8_t  HALTED = 0;
+    uint8_t  STUCK = STUCK_NONE;    // A StuckReason, kept with the state so a restore brings back its own
+    uint8_t  RESERVED[2] = {};
+
+    uint64_t MCYCLES = 0;
+};
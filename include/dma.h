@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+class Bus;
+
+constexpr uint64_t OAM_DMA_CYCLES   = 160;   // One byte per M-cycle
+constexpr uint64_t HDMA_BLOCK_CYCLES = 8;    // M-cycles the CPU is stalled per 16-byte block
+
+struct DMAState {
+    uint8_t  OAM_SOURCE = 0xFF;     // FF46, the high byte of the source address
+    uint8_t  RESERVED0[7] = {};
+    uint64_t OAM_END = 0;           // First M-cycle after the OAM DMA window
+
+    uint16_t HDMA_SOURCE = 0;       // FF51-FF52, advanced as blocks are copied
+    uint16_t HDMA_DEST = 0;         // FF53-FF54, offset into VRAM, advanced as blocks are copied
+    uint8_t  HDMA_LENGTH = 0xFF;    // FF55: blocks left minus one, bit 7 set when idle
+    uint8_t  RESERVED1[3] = {};
+};
+
+/*
+ * DMA - OAM DMA (0xFF46) and CGB VRAM DMA (0xFF51-0xFF55).
+ *
+ * Every transfer is a block copy between the memories behind the bus, never a byte-by-byte walk
+ * through Bus::write_n8. OAM DMA copies all 160 bytes when it starts; while the window lasts the
+ * bus hides everything below 0xFF00 from the CPU, so it cannot tell the bytes arrived at once.
+ * General purpose DMA copies everything immediately and HBlank DMA copies 16 bytes at the start
+ * of every HBlank; both stall the CPU for the time the copy takes through CPUState::STALL.
+ *
+ * VRAM DMA only exists on the CGB and stays disabled (its registers read 0xFF) unless
+ * set_cgb_mode() turns it on.
+ *
+ * Reference: https://gbdev.io/pandocs/OAM_DMA_Transfer.html
+ *            https://gbdev.io/pandocs/CGB_Registers.html#lcd-vram-dma-transfers
+ */
+class DMA {
+public:
+    DMA(Bus *bus) : m_bus(bus) {}
+
+    uint8_t read_register(uint16_t address);
+    void    write_register(uint16_t address, uint8_t data, uint64_t now);
+    void    on_hblank(uint64_t now);
+
+    /*
+     * blocks - Whether OAM DMA keeps the CPU off everything below 0xFF00.
+     * @now: the current M-cycle.
+     */
+    bool blocks(uint64_t now) const { return now < m_state.OAM_END; }
+
+    /*
+     * hblank_active - Whether an HBlank DMA waits for the next HBlank.
+     */
+    bool hblank_active() const { return !(m_state.HDMA_LENGTH & 0x80); }
+
+    void set_cgb_mode(bool enabled) { m_cgb = enabled; }
+    bool is_cgb_mode() const { return m_cgb; }
+
+    DMAState &get_state() { return m_state; }
+
+private:
+    DMAState m_state;
+    Bus *m_bus;
+    bool m_cgb = false;
+
+    void start_oam(uint8_t source, uint64_t now);
+    void copy_blocks(unsigned count, uint64_t now);
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+#include <vector>
+#include "cpu.h"
+#include "snapshot.h"
+
+/*
+ * ForkPoint - Where ForkServer::boot() stops: at the end of frame FRAME, or at the first
+ *             instruction fetched from PC if PC is not negative, whichever comes first.
+ */
+struct ForkPoint {
+    uint64_t frame = 0;
+    int32_t  pc = -1;
+    uint64_t cycle_limit = UINT64_MAX;      // Gives up if neither is reached by this M-cycle
+};
+
+/*
+ * ForkServer - Boots a machine once and hands out copies of it at the fork point.
+ *
+ * Jobs either run in a child process forked from the booted machine, which shares every page
+ * with it until written, or in-process on a pooled instance the fork point snapshot is copied
+ * into. Pooled instances are created on demand, keep their own copy of the ROM and are reused,
+ * so after warm-up acquiring one costs a snapshot restore. They run headless and without audio
+ * synthesis, like the forked children of the emulator's headless server.
+ *
+ * A forked child only inherits the calling thread, so the booted machine must not use the
+ * pipelined renderer or anything else running on another thread when fork_job() is called.
+ */
+class ForkServer {
+public:
+    ForkServer(CPU &cpu) : m_cpu(cpu) {}
+
+    bool boot(const ForkPoint &point);
+    const Snapshot &get_snapshot() const { return *m_snapshot; }
+
+    CPU *acquire();
+    void release(CPU *cpu);
+
+    pid_t fork_job(const std::function<int(CPU &)> &job);
+    static int wait_job(pid_t pid);
+
+private:
+    CPU &m_cpu;
+    std::unique_ptr<Snapshot> m_snapshot = std::make_unique<Snapshot>();
+
+    std::mutex m_pool_lock;
+    std::vector<std::unique_ptr<CPU>> m_pool;
+    std::vector<CPU *> m_idle;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include "ppu.h"
+
+enum class PixelFormat : uint8_t {
+    RGBA8888,    // 4 bytes per pixel, R G B A in memory order
+    RGB565,      // 2 bytes per pixel, native-endian 16-bit words
+    GRAYSCALE8,  // 1 byte per pixel, BT.601 luma (the Y plane of a YUV encoder input)
+};
+
+size_t bytes_per_pixel(PixelFormat format);
+
+/*
+ * FrameConverter - Converts the PPU's shade framebuffer to a caller's pixel format.
+ *
+ * The four output colors are computed once per palette, so a frame conversion is only a table
+ * lookup per pixel, done 16 pixels at a time with SSE2 where available. Output goes straight into
+ * the caller's buffer; no intermediate frame is made.
+ */
+class FrameConverter {
+public:
+    /*
+     * FrameConverter - Creates a converter.
+     * @format:  the output pixel format.
+     * @palette: the 0xRRGGBB color of each shade, lightest (0) to darkest (3).
+     */
+    FrameConverter(PixelFormat format, const uint32_t palette[4] = DMG_GRAY);
+
+    void set_palette(const uint32_t palette[4]);
+
+    void convert(const Frame &frame, void *dst, size_t pitch, const std::bitset<SCREEN_HEIGHT> *lines = nullptr) const;
+    void convert_line(const uint8_t *shades, void *dst) const;
+
+    PixelFormat get_format() const { return m_format; }
+
+    static constexpr uint32_t DMG_GRAY[4] = { 0xFFFFFF, 0xAAAAAA, 0x555555, 0x000000 };
+
+private:
+    PixelFormat m_format;
+    uint32_t m_rgba[4];
+    uint16_t m_rgb565[4];
+    uint8_t  m_gray[4];
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include "ppu.h"
+
+class Bus;
+class CPU;
+
+/*
+ * xxh64 - XXH64 hash of a byte range. Chaining calls through @seed hashes several regions.
+ * @data: the bytes to hash.
+ * @size: the number of bytes.
+ * @seed: the seed, or the previous hash when chaining.
+ *
+ * Return: the 64-bit hash.
+ *
+ * Reference: https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+ */
+inline uint64_t xxh64(const void *data, size_t size, uint64_t seed = 0)
+{
+    constexpr uint64_t P1 = 11400714785074694791ULL;
+    constexpr uint64_t P2 = 14029467366897019727ULL;
+    constexpr uint64_t P3 = 1609587929392839161ULL;
+    constexpr uint64_t P4 = 9650029242287828579ULL;
+    constexpr uint64_t P5 = 2870177450012600261ULL;
+
+    auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto round = [&rotl](uint64_t acc, uint64_t input) { return rotl(acc + input * P2, 31) * P1; };
+    auto read64 = [](const uint8_t *p) { uint64_t v; std::memcpy(&v, p, 8); return v; };
+    auto read32 = [](const uint8_t *p) { uint32_t v; std::memcpy(&v, p, 4); return (uint64_t)v; };
+
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    const uint8_t *end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + P1 + P2;
+        uint64_t v2 = seed + P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - P1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        for (uint64_t v : { v1, v2, v3, v4 }) {
+            h = (h ^ round(0, v)) * P1 + P4;
+        }
+    } else {
+        h = seed + P5;
+    }
+
+    h += size;
+    for (; p + 8 <= end; p += 8) {
+        h = rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+    }
+    if (p + 4 <= end) {
+        h = rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h = rotl(h ^ (*p * P5), 11) * P1;
+    }
+
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t hash_frame(const Frame &frame)
+{
+    return xxh64(frame.pixels, sizeof(frame.pixels));
+}
+
+uint64_t hash_machine(CPU &cpu);
+uint64_t hash_rom(CPU &cpu);
+
+/*
+ * StateHasher - A 64-bit hash of the whole machine state, cheap enough to take every frame.
+ *
+ * Covers every snapshot section: the CPU, scheduler and subsystem states, all RAM, OAM, IO and
+ * the joypad; the ROM is left out, as by hash_machine(). The sections have no padding, so the
+ * hash depends on nothing but the state and two machines in the same state agree on it whatever
+ * thread or host they ran on. Audio synthesis advances APU state that a machine without it
+ * leaves alone, so only compare machines with the same synthesis setting.
+ *
+ * RAM is hashed per 256-byte page, and update() only rehashes the pages the bus reports written
+ * since the previous update (Bus::take_written_pages(), so one hasher per machine); the rest is
+ * small and hashed in full. Writes that bypass the bus must be reported with Bus::mark_dirty().
+ */
+class StateHasher {
+public:
+    StateHasher() {}
+
+    uint64_t update(Bus &bus);
+    void invalidate() { m_valid = false; }
+
+private:
+    static constexpr size_t PAGES = 0x2000 / 0x100;
+
+    uint64_t m_wram[PAGES] = {};
+    uint64_t m_vram[PAGES] = {};
+    uint64_t m_eram[PAGES] = {};
+    bool m_valid = false;
+};
+
+/*
+ * FrameHashLog - Streams "<frame number> <hash>" lines, one per completed frame, to a file.
+ *
+ * Intended as (or inside) a PPU frame callback; golden runs are compared with a plain diff.
+ * Frames with no dirty lines reuse the previous hash instead of rehashing the buffer.
+ */
+class FrameHashLog {
+public:
+    FrameHashLog() {};
+
+    bool open(const std::string &filename);
+    void on_frame(const Frame &frame);
+
+    uint64_t get_last_hash() const { return m_last_hash; }
+
+private:
+    std::ofstream m_file;
+    uint64_t m_last_hash = 0;
+    uint64_t m_last_frame = 0;
+};
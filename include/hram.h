@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+/* Reference: https://gbdev.io/pandocs/Memory_Map.html */
+class HRAM {
+public:
+    HRAM() {};
+    ~HRAM() = default;
+
+    /*
+     * read_n8 - Reads an 8-bit value from HRAM.
+     * @address: the bus address to read from (0xFF80-0xFFFE).
+     *
+     *   Return: the 8-bit value read from HRAM.
+     */
+    uint8_t read_n8(uint16_t address) { return m_data[address & 0x7F]; }
+
+    /*
+     * write_n8 - Writes an 8-bit value to HRAM.
+     * @address: the bus address to write to (0xFF80-0xFFFE).
+     * @data:    the 8-bit value to write.
+     */
+    void write_n8(uint16_t address, uint8_t data) { m_data[address & 0x7F] = data; }
+
+    uint8_t *data() { return m_data; }
+
+private:
+    uint8_t m_data[0x80] = {0}; // 127 bytes used, 0xFFFF is IE
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cpu.h"
+#include "snapshot.h"
+
+/*
+ * SearchChild - One input choice tried from a state.
+ */
+struct SearchChild {
+    uint8_t BUTTONS = 0;                // The buttons held for the frames run
+    double  SCORE = 0;
+    bool    FAILED = false;             // The machine hung or threw; SCORE is -infinity
+    std::unique_ptr<Snapshot> STATE;    // The state after the frames, if kept
+};
+
+/*
+ * SearchPath - The best input sequence beam_search() found.
+ */
+struct SearchPath {
+    std::vector<uint8_t> INPUTS;        // Buttons for each step, each held for the step's frames
+    double SCORE = 0;
+};
+
+struct SearchStats {
+    uint64_t CHILDREN = 0;              // Input choices evaluated
+    uint64_t FRAMES = 0;                // Frames emulated for them
+    uint64_t ELAPSED_NS = 0;            // Wall-clock time spent running them
+};
+
+/*
+ * InputSearch - Explores input sequences from snapshots on a pool of worker threads.
+ *
+ * expand() branches a state into one child per input choice, runs every child for the same
+ * number of frames with its buttons held and scores the state it ends in. The children of all
+ * the states expanded together are spread over the workers, each of which owns one machine
+ * (with its own copy of the ROM, headless and without audio synthesis) that it restores the
+ * parent snapshot into for every child; the machines and the snapshots of kept states are
+ * recycled, so a search allocates nothing once warm.
+ *
+ * The score callback reads the guest (typically RAM through the bus) and runs on the worker
+ * threads, several at a time on different machines, so it must not touch shared state unlocked.
+ */
+class InputSearch {
+public:
+    using Score = std::function<double(CPU &cpu)>;
+
+    InputSearch(CPU &prototype, unsigned threads = 0);
+    ~InputSearch();
+
+    InputSearch(const InputSearch &) = delete;
+    InputSearch &operator=(const InputSearch &) = delete;
+
+    std::vector<SearchChild> expand(const Snapshot &from, const std::vector<uint8_t> &choices, unsigned frames,
+                                    const Score &score, bool keep_states = false);
+    SearchPath beam_search(const Snapshot &from, const std::vector<uint8_t> &choices, unsigned frames,
+                           unsigned depth, unsigned beam_width, const Score &score);
+
+    std::unique_ptr<Snapshot> take_state();
+    void recycle(std::unique_ptr<Snapshot> state);
+
+    unsigned get_threads() const { return m_workers.size(); }
+    const SearchStats &get_stats() const { return m_stats; }
+    void reset_stats() { m_stats = SearchStats(); }
+
+private:
+    struct Task {
+        const Snapshot *from;
+        SearchChild *child;
+    };
+
+    std::vector<std::unique_ptr<CPU>> m_instances;    // One per worker
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    bool m_stopping = false;
+    uint64_t m_generation = 0;          // Bumped for every batch
+    unsigned m_finished = 0;            // Workers done with the current batch
+
+    // The current batch, only written while every worker is idle
+    std::vector<Task> m_tasks;
+    const Score *m_score = nullptr;
+    unsigned m_frames = 0;
+    std::atomic<size_t> m_next {0};
+
+    std::vector<std::unique_ptr<Snapshot>> m_free_states;
+    SearchStats m_stats;
+
+    void run_batch();
+    void work(CPU &cpu);
+    unsigned run_task(CPU &cpu, const Task &task);
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * IO - Backing store for the IO registers (0xFF00-0xFF7F) that no subsystem claims yet.
+ *
+ * Reference: https://gbdev.io/pandocs/Hardware_Reg_List.html
+ */
+class IO {
+public:
+    IO() {};
+    ~IO() = default;
+
+    /*
+     * read_n8 - Reads an 8-bit IO register.
+     * @address: the bus address to read from (0xFF00-0xFF7F).
+     *
+     *   Return: the 8-bit register value.
+     */
+    uint8_t read_n8(uint16_t address) { return m_data[address & 0x7F]; }
+
+    /*
+     * write_n8 - Writes an 8-bit IO register.
+     * @address: the bus address to write to (0xFF00-0xFF7F).
+     * @data:    the 8-bit value to write.
+     */
+    void write_n8(uint16_t address, uint8_t data) { m_data[address & 0x7F] = data; }
+
+    uint8_t *data() { return m_data; }
+
+private:
+    uint8_t m_data[0x80] = {0};
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+/* Joypad buttons, one bit each in the masks passed to Joypad::set_buttons() */
+enum Button : uint8_t {
+    BUTTON_RIGHT  = 1 << 0,
+    BUTTON_LEFT   = 1 << 1,
+    BUTTON_UP     = 1 << 2,
+    BUTTON_DOWN   = 1 << 3,
+    BUTTON_A      = 1 << 4,
+    BUTTON_B      = 1 << 5,
+    BUTTON_SELECT = 1 << 6,
+    BUTTON_START  = 1 << 7,
+};
+
+struct JoypadState {
+    uint8_t SELECT = 0x30;      // P1 bits 4-5, active low: bit 4 selects the d-pad, bit 5 the buttons
+    uint8_t BUTTONS = 0;        // Held buttons, a mask of Button
+    uint8_t RESERVED[6] = {};
+};
+
+/*
+ * Joypad - The joypad register P1 (0xFF00).
+ *
+ * The d-pad and the buttons share the four active-low input lines; the game picks which group
+ * they show by clearing bit 4 or 5. A line falling while its group is selected requests the
+ * joypad interrupt.
+ *
+ * Reference: https://gbdev.io/pandocs/Joypad_Input.html
+ */
+class Joypad {
+public:
+    uint8_t read_register() const { return 0xC0 | m_state.SELECT | (~lines() & 0x0F); }
+    void    write_register(uint8_t data) { m_state.SELECT = data & 0x30; }
+
+    /*
+     * set_buttons - Replaces the set of held buttons.
+     * @buttons:         a mask of Button.
+     * @interrupt_flags: the IF register, updated with a joypad request if a visible line fell.
+     */
+    void set_buttons(uint8_t buttons, uint8_t &interrupt_flags) {
+        uint8_t before = lines();
+        m_state.BUTTONS = buttons;
+        if (lines() & ~before) {
+            interrupt_flags |= 0x10;
+        }
+    }
+
+    JoypadState &get_state() { return m_state; }
+
+private:
+    JoypadState m_state;
+
+    /*
+     * lines - The input lines pulled low by held buttons of the selected groups, active high.
+     */
+    uint8_t lines() const {
+        uint8_t pressed = 0;
+        if (!(m_state.SELECT & 0x10)) {
+            pressed |= m_state.BUTTONS & 0x0F;
+        }
+        if (!(m_state.SELECT & 0x20)) {
+            pressed |= m_state.BUTTONS >> 4;
+        }
+        return pressed;
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "scheduler.h"
+#include "spsc_queue.h"
+
+constexpr uint64_t LINK_SYNC_CYCLES = 1024;   // M-cycles of one 8 KHz byte transfer
+
+struct LinkTransfer {
+    uint64_t time;      // M-cycle the transfer completes at
+    uint8_t  data;
+};
+
+/*
+ * LinkPort - One end of a LinkCable, used by a single emulator thread.
+ *
+ * Each end publishes two clocks: how far it has run (arrival) and up to when it has answered
+ * every transfer sent to it (done). A master posts its byte to the peer when a transfer starts
+ * and collects the answer when it completes; everything else is the peer's business.
+ */
+class LinkPort {
+public:
+    void post(uint64_t time, uint8_t data);
+    void reply(uint64_t time, uint8_t data);
+    bool receive(LinkTransfer &transfer);
+    uint8_t await_reply(uint64_t time);
+
+    void arrive(uint64_t now) { m_arrival.store(now, std::memory_order_release); }
+    void done(uint64_t now) { m_done.store(now, std::memory_order_release); }
+    void wait_for_peer(uint64_t now);
+
+private:
+    friend class LinkCable;
+    LinkPort *m_peer = nullptr;
+
+    SPSCQueue<LinkTransfer, 16> m_inbox;     // Transfers the peer started, written by the peer
+    SPSCQueue<LinkTransfer, 16> m_replies;   // Answers to our transfers, written by the peer
+    alignas(64) std::atomic<uint64_t> m_arrival {0};
+    alignas(64) std::atomic<uint64_t> m_done {0};
+};
+
+/*
+ * LinkCable - Connects the serial ports of two emulator instances in the same process.
+ *
+ * Both instances count M-cycles from the same origin and may run on separate threads. They
+ * never sync per cycle: an instance only waits while it is armed as the external-clock side of a
+ * transfer (and then at most once per transfer time), or when its own transfer completes and
+ * the peer has not yet reached that cycle. Transfers complete on both sides at the exact cycle
+ * they would on hardware, so linked runs are deterministic.
+ */
+class LinkCable {
+public:
+    LinkCable() {
+        m_ports[0].m_peer = &m_ports[1];
+        m_ports[1].m_peer = &m_ports[0];
+    }
+
+    LinkPort *get_port(int side) { return &m_ports[side]; }
+
+private:
+    LinkPort m_ports[2];
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "cpu.h"
+
+constexpr char     MOVIE_MAGIC[8] = { 'G', 'B', 'M', 'O', 'V', 'I', 'E', 0 };
+constexpr uint32_t MOVIE_VERSION = 1;
+constexpr size_t   MOVIE_BUFFER_SIZE = 1 << 20;
+constexpr uint64_t MOVIE_UNKNOWN_LENGTH = UINT64_MAX;   // FRAME_COUNT of a recording that never ended
+
+/*
+ * MovieHeader - The start of a movie file. START_STATE_SIZE bytes of start state path follow.
+ *
+ * The body is one byte per frame, the joypad buttons (a mask of Button) held during that frame.
+ * After every HASH_INTERVAL frames comes the 8-byte hash_machine() of the state at the end of the
+ * last of them. All fields are little-endian.
+ *
+ * The hashes are hash_machine() rather than StateHasher: it covers only what the game can observe
+ * (CPU, RAM and IO registers), so a movie recorded with audio synthesis verifies on a headless
+ * replay, whose APU never advances its waveforms; and it leaves the bus's written pages to the
+ * one StateHasher a machine may have, e.g. that of --hash-states.
+ */
+struct MovieHeader {
+    char     MAGIC[8];
+    uint32_t VERSION;
+    uint32_t HASH_INTERVAL;         // 0 for no embedded hashes
+    uint64_t ROM_HASH;              // xxh64 of the cartridge ROM the movie was recorded with
+    uint64_t FRAME_COUNT;           // Filled in when the recording ends
+    uint32_t START_STATE_SIZE;      // 0 to start from power-on
+    uint32_t RESERVED;
+};
+
+/*
+ * MovieWriter - Records a movie as the frames are run.
+ */
+class MovieWriter {
+public:
+    MovieWriter() {}
+    ~MovieWriter() { close(); }
+
+    MovieWriter(const MovieWriter &) = delete;
+    MovieWriter &operator=(const MovieWriter &) = delete;
+
+    bool open(const std::string &path, CPU &cpu, uint32_t hash_interval, const std::string &start_state = "");
+    void write_frame(uint8_t buttons, CPU &cpu);
+    bool close();
+
+    bool is_open() const { return m_fd >= 0; }
+    uint64_t get_frames() const { return m_frames; }
+
+private:
+    int m_fd = -1;
+    uint32_t m_hash_interval = 0;
+    uint64_t m_frames = 0;
+    bool m_failed = false;
+    std::vector<uint8_t> m_buffer;
+
+    void append(const void *data, size_t size);
+    void flush();
+};
+
+/*
+ * MovieReader - Streams a movie from disk in MOVIE_BUFFER_SIZE reads.
+ */
+class MovieReader {
+public:
+    MovieReader() {}
+    ~MovieReader() { close(); }
+
+    MovieReader(const MovieReader &) = delete;
+    MovieReader &operator=(const MovieReader &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+    bool prepare(CPU &cpu);
+    bool read_frame(uint8_t &buttons, bool &check, uint64_t &hash);
+
+    bool is_open() const { return m_fd >= 0; }
+    bool is_damaged() const { return m_damaged; }
+    const MovieHeader &get_header() const { return m_header; }
+    const std::string &get_start_state() const { return m_start_state; }
+
+private:
+    int m_fd = -1;
+    MovieHeader m_header {};
+    std::string m_start_state;
+    uint64_t m_frames = 0;
+    bool m_damaged = false;
+
+    std::vector<uint8_t> m_buffer;
+    size_t m_position = 0;
+    size_t m_end = 0;
+
+    bool read_bytes(void *data, size_t size);
+};
+
+/*
+ * MovieReplay - The outcome of replay_movie().
+ */
+struct MovieReplay {
+    uint64_t FRAMES = 0;            // Frames run
+    uint64_t VERIFIED = 0;          // Embedded hashes that matched
+    int64_t  DESYNC_FRAME = -1;     // Frames run when a hash first did not match, or -1
+};
+
+/* Runs one frame of the machine, by default with run_to_frame_end() */
+using FrameRunner = std::function<void(CPU &cpu)>;
+
+bool play_frame(MovieReader &movie, CPU &cpu, MovieReplay &result, const FrameRunner &run_frame = nullptr,
+                uint8_t *buttons = nullptr);
+bool replay_movie(MovieReader &movie, CPU &cpu, MovieReplay &result);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+/* Reference: https://gbdev.io/pandocs/OAM.html */
+class OAM {
+public:
+    OAM() {};
+    ~OAM() = default;
+
+    /*
+     * read_n8 - Reads an 8-bit value from OAM. The unusable area after the sprite table reads as 0xFF.
+     * @address: the bus address to read from (0xFE00-0xFEFF).
+     *
+     *   Return: the 8-bit value read from OAM.
+     */
+    uint8_t read_n8(uint16_t address) {
+        uint8_t offset = address & 0xFF;
+        return (offset < sizeof(m_data)) ? m_data[offset] : 0xFF;
+    }
+
+    /*
+     * write_n8 - Writes an 8-bit value to OAM. Writes to the unusable area are ignored.
+     * @address: the bus address to write to (0xFE00-0xFEFF).
+     * @data:    the 8-bit value to write.
+     */
+    void write_n8(uint16_t address, uint8_t data) {
+        uint8_t offset = address & 0xFF;
+        if (offset < sizeof(m_data)) {
+            m_data[offset] = data;
+        }
+    }
+
+    uint8_t *data() { return m_data; }
+
+private:
+    uint8_t m_data[0xA0] = {0}; // 40 sprites, 4 bytes each
+};
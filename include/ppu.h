@@ -0,0 +1,188 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include "oam.h"
+#include "scheduler.h"
+#include "vram.h"
+
+constexpr int SCREEN_WIDTH  = 160;
+constexpr int SCREEN_HEIGHT = 144;
+
+/* Line timings in M-cycles. Reference: https://gbdev.io/pandocs/Rendering.html */
+constexpr uint64_t PPU_OAM_SCAN_CYCLES = 20;
+constexpr uint64_t PPU_TRANSFER_CYCLES = 43;
+constexpr uint64_t PPU_HBLANK_CYCLES   = 51;
+constexpr uint64_t PPU_LINE_CYCLES     = 114;
+constexpr uint64_t PPU_FRAME_CYCLES    = PPU_LINE_CYCLES * 154;
+
+enum PPUMode : uint8_t {
+    PPU_MODE_HBLANK   = 0,
+    PPU_MODE_VBLANK   = 1,
+    PPU_MODE_OAM_SCAN = 2,
+    PPU_MODE_TRANSFER = 3,
+};
+
+/*
+ * Frame - A completed frame of DMG shades (0-3, after BGP/OBP0/OBP1 were applied).
+ *
+ * dirty_lines has a bit set for every line that differs from the previous frame (all of them for
+ * the first frame), so consumers that keep the previous output can skip unchanged rows.
+ */
+struct Frame {
+    uint8_t  pixels[SCREEN_HEIGHT][SCREEN_WIDTH] = {};
+    uint64_t number = 0;
+    std::bitset<SCREEN_HEIGHT> dirty_lines;
+};
+
+using FrameCallback = std::function<void(const Frame &)>;
+
+struct PPUState {
+    uint8_t LCDC = 0;
+    uint8_t STAT = 0;
+    uint8_t SCY = 0;
+    uint8_t SCX = 0;
+    uint8_t LY = 0;
+    uint8_t LYC = 0;
+    uint8_t BGP = 0;
+    uint8_t OBP0 = 0;
+    uint8_t OBP1 = 0;
+    uint8_t WY = 0;
+    uint8_t WX = 0;
+
+    uint8_t MODE = PPU_MODE_HBLANK;
+    uint8_t WINDOW_LINE = 0;
+    uint8_t RESERVED[3] = {};
+
+    uint64_t FRAMES = 0;
+};
+
+/*
+ * PPUWrite - One entry of the pipelined renderer's log.
+ *
+ * WRITE entries carry a VRAM, OAM or register write; LINE entries ask the renderer to draw line
+ * @data with the state built up so far; FRAME entries close the frame. Entries are logged in the
+ * order the synchronous renderer would observe them, so both renderers produce identical frames.
+ */
+struct PPUWrite {
+    enum Kind : uint8_t { WRITE, LINE, FRAME };
+
+    uint64_t mcycle;
+    uint16_t address;
+    uint8_t  data;
+    uint8_t  kind;
+};
+
+class RenderThread;
+
+/*
+ * render_scanline - Draws line @state.LY (background, window and sprites) into @frame and marks
+ *                   it dirty if it differs from what the previous frame had there.
+ * @vram:  the 8KB of VRAM.
+ * @oam:   the 160 bytes of OAM.
+ * @state: the register state to draw with; WINDOW_LINE is advanced when the window is visible.
+ * @frame: the frame being drawn, still holding the previous frame's pixels.
+ */
+void render_scanline(const uint8_t *vram, const uint8_t *oam, PPUState &state, Frame &frame);
+
+/*
+ * skip_scanline - Does what render_scanline() does to @state without drawing anything.
+ * @state: the register state; WINDOW_LINE is advanced when the window is visible.
+ */
+void skip_scanline(PPUState &state);
+
+/*
+ * store_register - Stores a PPU register write into @state without any timing side effects.
+ * @state:   the state to update.
+ * @address: the register address.
+ * @data:    the value written.
+ */
+void store_register(PPUState &state, uint16_t address, uint8_t data);
+
+/*
+ * PPU - DMG picture processing unit.
+ *
+ * Mode and LY changes are driven by scheduler events, so STAT, LY and the VBlank/STAT interrupts
+ * are always exact on the CPU side. Pixel generation either happens inline at the start of mode 3
+ * or, in pipelined mode, on a render thread that replays a log of PPU-relevant writes.
+ *
+ * Reference: https://gbdev.io/pandocs/Graphics.html
+ */
+class PPU {
+public:
+    PPU(VRAM *vram, OAM *oam, Scheduler *scheduler);
+    ~PPU();
+
+    uint8_t read_register(uint16_t address);
+    void    write_register(uint16_t address, uint8_t data, uint64_t now);
+    void    on_event(uint64_t now, uint8_t &interrupt_flags);
+
+    /*
+     * record_write - Logs a VRAM or OAM write for the render thread. No-op unless pipelined.
+     * @now:     the M-cycle of the write.
+     * @address: the bus address written.
+     * @data:    the value written.
+     */
+    void record_write(uint64_t now, uint16_t address, uint8_t data) {
+        if (m_render_thread) {
+            log(PPUWrite { now, address, data, PPUWrite::WRITE });
+        }
+    }
+
+    /*
+     * record_block - Logs a block copy into VRAM or OAM for the render thread. No-op unless
+     *                pipelined.
+     * @now:     the M-cycle of the copy.
+     * @address: the bus address of the first byte.
+     * @data:    the bytes as they now are in memory.
+     * @length:  the number of bytes.
+     */
+    void record_block(uint64_t now, uint16_t address, const uint8_t *data, size_t length) {
+        if (m_render_thread) {
+            for (size_t i = 0; i < length; i++) {
+                log(PPUWrite { now, static_cast<uint16_t>(address + i), data[i], PPUWrite::WRITE });
+            }
+        }
+    }
+
+    /*
+     * set_rendering - Turns pixel generation and the frame callback on or off. Timing, interrupts
+     *                 and register state are the same either way. Only the inline renderer can
+     *                 be turned off.
+     * @enabled: false to run headless.
+     */
+    void set_rendering(bool enabled) { m_rendering = enabled; }
+    bool is_rendering() const { return m_rendering; }
+
+    void set_pipelined(bool enabled);
+    bool is_pipelined() const { return m_render_thread != nullptr; }
+    void flush();
+    void resync();
+
+    /*
+     * set_frame_callback - Sets the function called with every completed frame. In pipelined mode
+     *                      it is called on the render thread, one frame behind the CPU.
+     * @callback: the function to call, or nullptr.
+     */
+    void set_frame_callback(FrameCallback callback);
+
+    const Frame &get_frame() const { return m_frame; }
+    PPUState &get_state() { return m_state; }
+
+private:
+    PPUState m_state;
+    VRAM *m_vram;
+    OAM *m_oam;
+    Scheduler *m_scheduler;
+
+    Frame m_frame;
+    bool  m_rendering = true;
+    FrameCallback m_frame_callback;
+    std::unique_ptr<RenderThread> m_render_thread;
+
+    void log(const PPUWrite &entry);
+    void set_mode(uint8_t mode, uint8_t &interrupt_flags);
+    void compare_ly(uint8_t &interrupt_flags);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "ppu.h"
+#include "spsc_queue.h"
+
+/*
+ * RenderThread - Consumer side of the pipelined PPU.
+ *
+ * Owns shadow copies of VRAM, OAM and the PPU registers, applies the logged writes to them in
+ * order and draws a line whenever a LINE entry arrives. The CPU thread only appends to the log,
+ * so pixel generation runs on another core, one frame behind emulation.
+ *
+ * When the log stays empty for a while the render thread goes to sleep, and the CPU thread wakes
+ * it with the next LINE or FRAME entry (or when the log fills up or is flushed), so a paused
+ * emulator does not keep a core busy.
+ */
+class RenderThread {
+public:
+    static constexpr size_t LOG_CAPACITY = 1 << 16;
+    static constexpr int    IDLE_SPINS = 64;    // Empty polls before the render thread sleeps
+
+    RenderThread(const uint8_t *vram, const uint8_t *oam, const PPUState &state, FrameCallback callback);
+    ~RenderThread();
+
+    void push(const PPUWrite &entry);
+    void flush();
+
+    /*
+     * set_frame_callback - Replaces the frame callback. Only call after flush().
+     * @callback: the function to call with each completed frame.
+     */
+    void set_frame_callback(FrameCallback callback) { m_frame_callback = std::move(callback); }
+
+private:
+    SPSCQueue<PPUWrite, LOG_CAPACITY> m_log;
+
+    uint8_t  m_vram[0x2000];
+    uint8_t  m_oam[0xA0];
+    PPUState m_state;
+    Frame    m_frame;
+    FrameCallback m_frame_callback;
+
+    uint64_t m_pushed = 0;
+    std::atomic<uint64_t> m_processed {0};
+    std::atomic<bool> m_running {true};
+    std::thread m_thread;
+
+    std::mutex m_sleep_lock;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_sleeping {false};
+
+    void run();
+    void wake();
+    void sleep();
+    void apply(const PPUWrite &entry);
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Resampler - Streaming stereo sample rate converter with a polyphase windowed-sinc filter.
+ *
+ * Every output sample is a TAPS-long dot product over the buffered input, with the kernel
+ * linearly interpolated between the two nearest of PHASES precomputed sub-sample phases, so any
+ * ratio works, including one that changes between calls. The dot products use SSE2 when
+ * available.
+ */
+class Resampler {
+public:
+    static constexpr int TAPS   = 32;
+    static constexpr int PHASES = 256;
+
+    Resampler(double input_rate, double output_rate);
+
+    void set_rates(double input_rate, double output_rate);
+
+    /*
+     * set_ratio - Fine-tunes the conversion without rebuilding the filter.
+     * @ratio: input samples consumed per output sample.
+     */
+    void   set_ratio(double ratio) { m_ratio = ratio; }
+    double get_ratio() const { return m_ratio; }
+    double get_nominal_ratio() const { return m_nominal_ratio; }
+
+    void   reset();
+    size_t process(const int16_t *in, size_t frames, int16_t *out, size_t max_frames);
+
+private:
+    alignas(16) float m_kernel[PHASES + 1][TAPS];
+    std::vector<float> m_left;      // Buffered input not yet fully consumed
+    std::vector<float> m_right;
+    double m_position = 0;          // Input index of the next output's first tap
+    double m_ratio = 1;
+    double m_nominal_ratio = 1;
+};
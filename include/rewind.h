@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "bus.h"
+#include "snapshot.h"
+
+/*
+ * Rewind - A ring of past machine states to step back through.
+ *
+ * Consecutive snapshots differ in a few hundred bytes, so an entry stores its snapshot XORed with
+ * the previous one, run-length coded: zero runs (unchanged bytes) become a count and only the
+ * changed bytes are kept. Every keyframe_interval entries a keyframe is coded against zeros
+ * instead. The newest state is kept decoded; since XOR is its own inverse, stepping back applies
+ * the newest delta to it, and only stepping back over a keyframe replays forward from the keyframe
+ * before. The oldest entry is always a keyframe: when the memory budget is exceeded the oldest
+ * keyframe is dropped together with its deltas.
+ */
+class Rewind {
+public:
+    Rewind(size_t budget = 4 << 20, unsigned interval = 1, unsigned keyframe_interval = 64);
+
+    void on_frame(Bus &bus);
+    bool rewind(Bus &bus);
+
+    void push(const Snapshot &snapshot);
+    bool pop(Snapshot &snapshot);
+    void clear();
+
+    size_t size() const { return m_entries.size(); }
+    size_t memory_used() const { return m_used; }
+
+private:
+    struct Entry {
+        std::vector<uint8_t> data;
+        bool keyframe;
+    };
+
+    std::deque<Entry> m_entries;
+    std::unique_ptr<Snapshot> m_newest;     // Decoded state of the newest entry
+    std::unique_ptr<Snapshot> m_current;    // The live state as of the last on_frame() or rewind()
+    std::vector<uint8_t> m_scratch;
+
+    size_t   m_budget;
+    size_t   m_used = 0;
+    unsigned m_interval;
+    unsigned m_keyframe_interval;
+    unsigned m_frames = 0;
+    unsigned m_since_keyframe = 0;
+
+    void decode_newest();
+    void evict();
+};
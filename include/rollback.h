@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "cpu.h"
+#include "snapshot.h"
+
+/*
+ * InputPacket - One player's joypad input for one frame, as sent to the other player.
+ */
+struct InputPacket {
+    uint32_t FRAME;
+    uint8_t  BUTTONS;           // A mask of Button
+    uint8_t  RESERVED[3];       // Explicit padding, sent as zeros
+};
+
+/*
+ * RollbackTransport - Carries input packets between the two sides of a session. Packets must
+ *                     arrive complete and in the order they were sent.
+ */
+class RollbackTransport {
+public:
+    virtual ~RollbackTransport() = default;
+
+    /*
+     * send - Sends a packet to the other side.
+     * @packet: the packet.
+     *
+     * Return: false if the other side is gone.
+     */
+    virtual bool send(const InputPacket &packet) = 0;
+
+    /*
+     * receive - Takes the next packet from the other side without waiting.
+     * @packet: set to the packet.
+     *
+     * Return: false if none has arrived.
+     */
+    virtual bool receive(InputPacket &packet) = 0;
+
+    /*
+     * is_closed - Whether the other side has closed the connection. The packets it sent before
+     *             have all been received once this is true.
+     */
+    virtual bool is_closed() const { return false; }
+};
+
+/*
+ * FdTransport - A RollbackTransport over file descriptors: the two ends of a pipe pair, or one
+ *               end of a connected stream socket for both directions.
+ *
+ * Reads never block. A send waits for room in the socket or pipe buffer when it is full.
+ */
+class FdTransport : public RollbackTransport {
+public:
+    FdTransport(int read_fd, int write_fd);
+
+    bool send(const InputPacket &packet) override;
+    bool receive(InputPacket &packet) override;
+    bool is_closed() const override { return m_closed; }
+
+private:
+    int m_read_fd;
+    int m_write_fd;
+    bool m_closed = false;          // A read hit the end of the stream
+    uint8_t m_partial[sizeof(InputPacket)];
+    size_t  m_partial_size = 0;     // Bytes of the next packet a stream read returned so far
+};
+
+struct RollbackStats {
+    uint64_t ROLLBACKS = 0;
+    uint64_t RESIMULATED = 0;       // Frames emulated again after a misprediction
+    uint32_t MAX_DEPTH = 0;         // Most frames one rollback went back
+};
+
+/*
+ * RollbackSession - One side of a two-player session with rollback.
+ *
+ * Both sides run the same machine from the same state. Its joypad gets the two players' input
+ * merged by the combine function (by default OR, both players share the pad), so the game's
+ * inputs and hence the machine state are a pure function of both input streams. Every frame
+ * the local input is sent to the other side and the frame runs at once, with the remote input
+ * predicted to be the last one received. When a remote input arrives that differs from its
+ * prediction, the session returns to the snapshot taken before that frame and emulates to the
+ * present again with the real input and with audio suspended, drawing only the last of those
+ * frames, so the screen shows the corrected present and the samples already played are not
+ * repeated.
+ *
+ * At most max_rollback frames may run ahead of the last confirmed remote input; advance()
+ * refuses to go further until the other side catches up.
+ *
+ * A machine that hangs (see CPU::get_stuck_reason()) in a frame run with a predicted input may
+ * be saved by the rollback that corrects it. Once the inputs of the frame it hung in are all
+ * confirmed the hang is final: the session is stuck and advances no further.
+ */
+class RollbackSession {
+public:
+    using Combine = std::function<uint8_t(uint8_t player0, uint8_t player1)>;
+
+    RollbackSession(CPU &cpu, RollbackTransport &transport, int local_player, unsigned max_rollback = 8);
+
+    bool advance(uint8_t buttons);
+    void poll();
+
+    void set_combine(Combine combine) { m_combine = std::move(combine); }
+
+    uint32_t get_frame() const { return m_frame; }
+    uint32_t get_confirmed_frames() const { return m_remote_frames; }
+    bool is_connected() const { return m_connected; }
+    bool is_stuck() const { return m_stuck; }
+    const RollbackStats &get_stats() const { return m_stats; }
+
+private:
+    CPU &m_cpu;
+    RollbackTransport &m_transport;
+    int m_local_player;
+    unsigned m_max_rollback;
+    Combine m_combine = [](uint8_t player0, uint8_t player1) -> uint8_t { return player0 | player1; };
+
+    uint32_t m_frame = 0;               // Frames run so far
+    uint32_t m_remote_frames = 0;       // Remote inputs received, for frames 0 to this - 1
+    uint32_t m_rollback_to = UINT32_MAX;
+    bool     m_connected = true;
+    uint32_t m_stuck_frame = UINT32_MAX;    // The first frame the machine hung in, if any
+    bool     m_stuck = false;               // It hung with confirmed inputs
+
+    // Rings indexed by frame number
+    std::vector<uint8_t>  m_local;
+    std::vector<uint8_t>  m_remote;
+    std::vector<uint8_t>  m_predicted;  // Remote input frame was last run with
+    std::vector<Snapshot> m_snapshots;  // State at the start of the frame, max_rollback + 1 of them
+
+    RollbackStats m_stats;
+
+    uint8_t remote_input(uint32_t frame) const;
+    bool    run(uint32_t frame);
+    void    rollback();
+};
@@ -93,7 +93,26 @@ public:
         }
     }
 
+    /*
+     * read_ram_n8 - Reads an 8-bit value from the cartridge's external RAM.
+     * @address: the bus address to read from (0xA000-0xBFFF).
+     *
+     *   Return: the 8-bit value read from external RAM.
+     */
+    uint8_t read_ram_n8(uint16_t address) { return m_ram[address & 0x1FFF]; }
+
+    /*
+     * write_ram_n8 - Writes an 8-bit value to the cartridge's external RAM.
+     * @address: the bus address to write to (0xA000-0xBFFF).
+     * @data:    the 8-bit value to write.
+     */
+    void write_ram_n8(uint16_t address, uint8_t data) { m_ram[address & 0x1FFF] = data; }
+
+    uint8_t *data() { return m_data; }
+    uint8_t *ram() { return m_ram; }
+
 private:
     uint8_t m_data[0x8000] = {0}; // 32KB ROM
+    uint8_t m_ram[0x2000] = {0};  // 8KB external RAM
 };
 
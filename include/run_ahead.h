@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "cpu.h"
+#include "snapshot.h"
+
+/*
+ * RunAheadStats - Where the host time of the frames run so far went, in nanoseconds.
+ */
+struct RunAheadStats {
+    uint64_t FRAMES = 0;        // Frames presented
+    uint64_t EMULATE_NS = 0;    // Running the real frames
+    uint64_t AHEAD_NS = 0;      // Running the frames ahead, the presented ones included
+    uint64_t SAVE_NS = 0;
+    uint64_t RESTORE_NS = 0;
+};
+
+/*
+ * RunAhead - Hides the game's own input lag by showing frames from the future.
+ *
+ * Each run_frame() emulates the real frame with audio but no video, snapshots the machine, runs
+ * the next frames ahead with the same input and neither video nor audio except for the last
+ * one's picture, which is what the frame callback presents, and returns to the snapshot. A game
+ * that reacts to input N frames late thus appears to react at once with N frames of run-ahead.
+ *
+ * The snapshot is kept in sync with dirty pages and returned to the same way, so saving and
+ * restoring cost little more than the pages the frames ahead write. Needs the inline renderer.
+ */
+class RunAhead {
+public:
+    RunAhead(unsigned frames = 1) : m_frames(frames) {}
+
+    void run_frame(CPU &cpu);
+
+    void set_frames(unsigned frames) { m_frames = frames; }
+    unsigned get_frames() const { return m_frames; }
+
+    const RunAheadStats &get_stats() const { return m_stats; }
+    void reset_stats() { m_stats = RunAheadStats(); }
+
+private:
+    unsigned m_frames;
+    std::unique_ptr<Snapshot> m_snapshot = std::make_unique<Snapshot>();
+    RunAheadStats m_stats;
+};
+
+/*
+ * run_to_frame_end - Steps the CPU until the PPU completes a frame, or for as long as a frame
+ *                    takes while the LCD is off.
+ * @cpu: the machine.
+ *
+ * Return: false if the CPU got stuck.
+ */
+bool run_to_frame_end(CPU &cpu);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "bus.h"
+#include "snapshot.h"
+
+constexpr char     SAVESTATE_MAGIC[8] = { 'G', 'B', 'S', 'T', 'A', 'T', 'E', 0 };
+constexpr uint32_t SAVESTATE_VERSION = 1;
+constexpr uint32_t SAVESTATE_PAGE_SIZE = 4096;
+constexpr uint32_t SAVESTATE_MAX_SECTIONS = 64;     // What fits in the first page
+
+/*
+ * SavestateHeader - The start of a savestate file. The section table follows it directly.
+ */
+struct SavestateHeader {
+    char     MAGIC[8];
+    uint32_t VERSION;           // Only bumped if the header or the table change shape
+    uint32_t SECTION_COUNT;
+    uint64_t FILE_SIZE;
+    uint64_t MCYCLES;           // Machine time of the state, for tools that list savestates
+};
+
+/*
+ * SavestateSection - One entry of the section table.
+ */
+struct SavestateSection {
+    uint32_t ID;                // SectionInfo::id
+    uint32_t VERSION;           // SectionInfo::version of the writer
+    uint64_t OFFSET;            // From the start of the file, a multiple of SAVESTATE_PAGE_SIZE
+    uint64_t SIZE;
+};
+
+static_assert(sizeof(SavestateHeader) + SAVESTATE_MAX_SECTIONS * sizeof(SavestateSection) <= SAVESTATE_PAGE_SIZE,
+              "header and section table fit the first page");
+
+bool save_state(const std::string &path, Bus &bus);
+
+/*
+ * Savestate - A savestate file mapped into memory.
+ *
+ * The file is the header and section table in the first page, then every section at a
+ * page-aligned offset, stored exactly as it is in memory (little-endian). open() maps the file and
+ * validates the table once; restore() is then one memcpy per section straight out of the mapping,
+ * so a state can be restored any number of times at the cost of copying it.
+ *
+ * Sections are matched by id and may come in any order. Sections this build does not know are
+ * skipped, a section from a newer writer is truncated to the layout known here and one from an
+ * older writer has its missing fields reset to defaults (see SectionInfo).
+ */
+class Savestate {
+public:
+    Savestate() {}
+    ~Savestate() { close(); }
+
+    Savestate(const Savestate &) = delete;
+    Savestate &operator=(const Savestate &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+    bool restore(Bus &bus) const;
+
+    bool is_open() const { return m_data != nullptr; }
+    const SavestateHeader *get_header() const { return reinterpret_cast<const SavestateHeader *>(m_data); }
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    const SavestateSection *m_sections[static_cast<size_t>(Section::COUNT)] = {};
+};
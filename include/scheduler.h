@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Event - The kinds of deferred work the scheduler can hold. Each kind has at most one pending
+ *         occurrence, so the event itself doubles as the slot index.
+ */
+enum class Event : uint8_t {
+    PPU,
+    APU,
+    TIMER,
+    SERIAL,
+    LINK,
+    COUNT
+};
+
+constexpr uint64_t NEVER = UINT64_MAX;
+
+struct SchedulerState {
+    uint64_t WHEN[static_cast<size_t>(Event::COUNT)];
+    uint64_t NEXT;
+};
+
+/*
+ * Scheduler - Keeps the M-cycle timestamp of the next occurrence of every event kind.
+ *
+ * Subsystems schedule their next state change instead of being ticked every cycle; the bus only
+ * compares the current cycle count against next() and dispatches when something is due.
+ */
+class Scheduler {
+public:
+    Scheduler() { reset(); }
+
+    void reset() {
+        for (uint64_t &when : m_state.WHEN) {
+            when = NEVER;
+        }
+        m_state.NEXT = NEVER;
+    }
+
+    /*
+     * schedule - Schedules an event, replacing any pending occurrence of the same kind.
+     * @event: the event to schedule.
+     * @when:  the M-cycle at which the event fires.
+     */
+    void schedule(Event event, uint64_t when) {
+        uint64_t &slot = m_state.WHEN[static_cast<size_t>(event)];
+        bool was_next = (slot == m_state.NEXT);
+        slot = when;
+        if (when < m_state.NEXT) {
+            m_state.NEXT = when;
+        } else if (was_next) {
+            update_next();  // Pushed back the earliest event
+        }
+    }
+
+    /*
+     * cancel - Removes the pending occurrence of an event, if any.
+     * @event: the event to cancel.
+     */
+    void cancel(Event event) {
+        m_state.WHEN[static_cast<size_t>(event)] = NEVER;
+        update_next();
+    }
+
+    /*
+     * pop - Takes the earliest event that is due at @now.
+     * @now:   the current M-cycle.
+     * @event: set to the due event.
+     * @when:  set to the cycle the event was scheduled for, which may be before @now.
+     *
+     * Return: true if an event was due.
+     */
+    bool pop(uint64_t now, Event &event, uint64_t &when) {
+        if (now < m_state.NEXT) {
+            return false;
+        }
+        size_t earliest = 0;
+        for (size_t i = 1; i < static_cast<size_t>(Event::COUNT); i++) {
+            if (m_state.WHEN[i] < m_state.WHEN[earliest]) {
+                earliest = i;
+            }
+        }
+        event = static_cast<Event>(earliest);
+        when = m_state.WHEN[earliest];
+        m_state.WHEN[earliest] = NEVER;
+        update_next();
+        return true;
+    }
+
+    uint64_t next() const { return m_state.NEXT; }
+    uint64_t when(Event event) const { return m_state.WHEN[static_cast<size_t>(event)]; }
+
+    SchedulerState &get_state() { return m_state; }
+
+private:
+    SchedulerState m_state;
+
+    void update_next() {
+        m_state.NEXT = NEVER;
+        for (uint64_t when : m_state.WHEN) {
+            if (when < m_state.NEXT) {
+                m_state.NEXT = when;
+            }
+        }
+    }
+};
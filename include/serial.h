@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "link_cable.h"
+#include "scheduler.h"
+
+constexpr uint64_t SERIAL_TRANSFER_CYCLES = 1024;   // 8 bits at 8192 Hz
+
+struct SerialState {
+    uint8_t  SB = 0;
+    uint8_t  SC = 0;
+    uint8_t  RESERVED[6] = {};
+    uint64_t TRANSFER_END = NEVER;  // M-cycle the internally clocked transfer completes at
+};
+
+/*
+ * Serial - The serial port, SB and SC (0xFF01-0xFF02).
+ *
+ * A transfer on the internal clock completes as one scheduled event SERIAL_TRANSFER_CYCLES after
+ * it starts. Without a link cable the other end reads as disconnected (0xFF) and transfers on the
+ * external clock never complete. With one, the port also syncs with the peer through a LINK
+ * event every LINK_SYNC_CYCLES and at the exact completion cycle of every transfer the peer
+ * drives.
+ *
+ * Reference: https://gbdev.io/pandocs/Serial_Data_Transfer_(Link_Cable).html
+ */
+class Serial {
+public:
+    Serial(Scheduler *scheduler) : m_scheduler(scheduler) {}
+
+    uint8_t read_register(uint16_t address);
+    void    write_register(uint16_t address, uint8_t data, uint64_t now);
+    void    on_event(uint64_t now, uint8_t &interrupt_flags);
+    void    on_link(uint64_t now, uint8_t &interrupt_flags);
+
+    void set_link(LinkPort *port, uint64_t now);
+
+    /*
+     * set_output_callback - Sets the function called with SB whenever a transfer on the internal
+     *                       clock starts, which is how test ROMs print. nullptr to disable.
+     * @callback: the function to call.
+     */
+    void set_output_callback(std::function<void(uint8_t)> callback) { m_output_callback = std::move(callback); }
+
+    SerialState &get_state() { return m_state; }
+
+private:
+    SerialState m_state;
+    Scheduler *m_scheduler;
+    LinkPort  *m_link = nullptr;
+    std::vector<LinkTransfer> m_pending;    // Transfers driven by the peer that have not ended
+    std::function<void(uint8_t)> m_output_callback;
+
+    /*
+     * armed - Whether the port waits for the peer's clock (SC bit 7 set, bit 0 clear).
+     */
+    bool armed() const { return (m_state.SC & 0x81) == 0x80; }
+
+    void complete(uint8_t data, uint8_t &interrupt_flags);
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "frame_output.h"
+
+/*
+ * Shared-memory frame ring layout. A ShmRingHeader is followed by slot_count slots of slot_bytes
+ * each; every slot starts with a ShmSlotHeader, followed by the pixels (pitch = width * bpp) and
+ * then audio_capacity interleaved stereo int16 samples.
+ *
+ * Reader protocol (per-slot seqlock, no locks, no copies required):
+ *   1. n = header.published; the newest frame is n, stored in slot (n - 1) % slot_count.
+ *   2. s = slot.sequence (acquire). If s != 2 * n the slot is being rewritten; retry.
+ *   3. Read the pixels/audio in place.
+ *   4. If slot.sequence (acquire) still equals s, what was read is consistent.
+ */
+constexpr uint32_t SHM_RING_MAGIC   = 0x47425346; // "GBSF"
+constexpr uint32_t SHM_RING_VERSION = 2;
+
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_bytes;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;            // PixelFormat
+    uint32_t audio_capacity;    // stereo frames per slot
+    std::atomic<uint64_t> published;
+};
+
+struct ShmSlotHeader {
+    std::atomic<uint64_t> sequence; // 2n while frame n is readable, odd while being written
+    uint64_t frame_number;          // the PPU's frame counter
+    uint32_t audio_frames;          // stereo frames of audio stored with this frame
+    uint32_t reserved;
+    uint64_t dirty_lines[3];        // bit y set if line y differs from the previous frame
+};
+
+/*
+ * SharedFrameRing - Publishes completed frames (and optional audio blocks) into a POSIX
+ *                   shared-memory ring for other processes.
+ *
+ * Frames are converted straight into the slot, so publishing costs one conversion and no copies.
+ * A slot is reused every slot_count frames, so only the lines dirtied by those frames are
+ * converted again. The writer never waits for readers; a slow reader sees a newer frame or a retry.
+ */
+class SharedFrameRing {
+public:
+    SharedFrameRing() {};
+    ~SharedFrameRing();
+
+    bool create(const std::string &name, PixelFormat format, uint32_t slot_count = 4, uint32_t audio_capacity = 0);
+    void close();
+
+    void publish(const Frame &frame, const int16_t *audio = nullptr, uint32_t audio_frames = 0);
+
+    uint64_t get_published() const { return m_header ? m_header->published.load() : 0; }
+
+private:
+    std::string m_name;
+    ShmRingHeader *m_header = nullptr;
+    size_t m_size = 0;
+    FrameConverter m_converter {PixelFormat::RGBA8888};
+
+    std::vector<std::bitset<SCREEN_HEIGHT>> m_dirty_history;    // dirty lines of the last slot_count frames
+    uint64_t m_last_frame = 0;
+    uint64_t m_contiguous = 0;  // publishes in a row whose frame number followed the previous one
+
+    uint8_t *slot(uint64_t index) const;
+};
+
+/*
+ * SharedFrameReader - Read side of a SharedFrameRing, for consumers written in C++.
+ */
+class SharedFrameReader {
+public:
+    SharedFrameReader() {};
+    ~SharedFrameReader();
+
+    bool open(const std::string &name);
+    void close();
+
+    /*
+     * latest - Number of the newest published frame, 0 if none yet.
+     */
+    uint64_t latest() const { return m_header->published.load(std::memory_order_acquire); }
+
+    const uint8_t *begin_read(uint64_t sequence, const ShmSlotHeader **slot_header = nullptr) const;
+    bool end_read(uint64_t sequence) const;
+
+    const ShmRingHeader *get_header() const { return m_header; }
+
+private:
+    ShmRingHeader *m_header = nullptr;
+    size_t m_size = 0;
+};
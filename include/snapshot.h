@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "apu.h"
+#include "cpu_state.h"
+#include "dma.h"
+#include "joypad.h"
+#include "ppu.h"
+#include "scheduler.h"
+#include "serial.h"
+#include "timer.h"
+
+/*
+ * Snapshot - Every piece of mutable machine state in one fixed-size block.
+ *
+ * The cartridge ROM is never written, so it is shared rather than copied. Frame and sample
+ * buffers are output, not state, and the link cable belongs to two machines at once, so none of
+ * them are part of a snapshot. Being trivially copyable, a snapshot can itself be copied, stored
+ * or compared as plain bytes.
+ */
+struct Snapshot {
+    CPUState       CPU;
+    SchedulerState SCHEDULER;
+    PPUState       PPU;
+    APUState       APU;
+    TimerState     TIMER;
+    SerialState    SERIAL;
+    DMAState       DMA;
+
+    uint8_t WRAM[0x2000];
+    uint8_t VRAM[0x2000];
+    uint8_t ERAM[0x2000];
+    uint8_t OAM[0xA0];
+    uint8_t IO[0x80];
+    uint8_t HRAM[0x80];
+
+    JoypadState    JOYPAD;
+};
+
+static_assert(std::is_trivially_copyable_v<Snapshot>, "snapshots are copied as bytes");
+static_assert(std::has_unique_object_representations_v<Snapshot>,
+              "snapshots have no padding, so equal states are equal bytes and hash alike");
+
+/*
+ * Section - The parts of a Snapshot, in the order they are laid out.
+ */
+enum class Section : uint8_t {
+    CPU,
+    SCHEDULER,
+    PPU,
+    APU,
+    TIMER,
+    SERIAL,
+    DMA,
+    WRAM,
+    VRAM,
+    ERAM,
+    OAM,
+    IO,
+    HRAM,
+    JOYPAD,
+    COUNT
+};
+
+/*
+ * SectionInfo - Where a section lives in a Snapshot and how it is tagged in a savestate file.
+ *
+ * A section's layout only ever grows at the end, and every change bumps its version. Readers copy
+ * the bytes they know and leave fields a file is too old to have at their defaults; an
+ * incompatible change gets a new id instead.
+ */
+struct SectionInfo {
+    uint32_t id;            // Four characters, e.g. 'WRAM'
+    uint32_t version;
+    size_t   offset;        // Offset in Snapshot
+    size_t   size;
+};
+
+constexpr uint32_t section_id(const char (&name)[5]) {
+    return uint32_t(name[0]) | uint32_t(name[1]) << 8 | uint32_t(name[2]) << 16 | uint32_t(name[3]) << 24;
+}
+
+inline constexpr SectionInfo SNAPSHOT_SECTIONS[] = {
+    { section_id("CPU "), 1, offsetof(Snapshot, CPU),       sizeof(Snapshot::CPU) },
+    { section_id("SCHD"), 1, offsetof(Snapshot, SCHEDULER), sizeof(Snapshot::SCHEDULER) },
+    { section_id("PPU "), 1, offsetof(Snapshot, PPU),       sizeof(Snapshot::PPU) },
+    { section_id("APU "), 1, offsetof(Snapshot, APU),       sizeof(Snapshot::APU) },
+    { section_id("TIMR"), 1, offsetof(Snapshot, TIMER),     sizeof(Snapshot::TIMER) },
+    { section_id("SERL"), 1, offsetof(Snapshot, SERIAL),    sizeof(Snapshot::SERIAL) },
+    { section_id("DMA "), 1, offsetof(Snapshot, DMA),       sizeof(Snapshot::DMA) },
+    { section_id("WRAM"), 1, offsetof(Snapshot, WRAM),      sizeof(Snapshot::WRAM) },
+    { section_id("VRAM"), 1, offsetof(Snapshot, VRAM),      sizeof(Snapshot::VRAM) },
+    { section_id("ERAM"), 1, offsetof(Snapshot, ERAM),      sizeof(Snapshot::ERAM) },
+    { section_id("OAM "), 1, offsetof(Snapshot, OAM),       sizeof(Snapshot::OAM) },
+    { section_id("IO  "), 1, offsetof(Snapshot, IO),        sizeof(Snapshot::IO) },
+    { section_id("HRAM"), 1, offsetof(Snapshot, HRAM),      sizeof(Snapshot::HRAM) },
+    { section_id("JOYP"), 1, offsetof(Snapshot, JOYPAD),    sizeof(Snapshot::JOYPAD) },
+};
+
+static_assert(sizeof(SNAPSHOT_SECTIONS) / sizeof(SectionInfo) == static_cast<size_t>(Section::COUNT),
+              "one SectionInfo per Section");
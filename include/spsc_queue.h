@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+
+/*
+ * SPSCQueue - Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ *
+ * The producer only writes m_tail and the consumer only writes m_head, so neither side ever
+ * waits on a lock. Each side caches the other side's index and only reloads it when the cached
+ * value says the queue looks full (producer) or empty (consumer).
+ *
+ * @T: the element type, copied in and out.
+ * @N: the capacity, must be a power of two.
+ */
+template<typename T, size_t N>
+class SPSCQueue {
+    static_assert((N & (N - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+public:
+    /*
+     * push - Appends an element. Producer thread only.
+     * @item: the element to append.
+     *
+     * Return: false if the queue is full.
+     */
+    bool push(const T &item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_cache == N) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_cache == N) {
+                return false;
+            }
+        }
+        m_buffer[tail & (N - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*
+     * pop - Removes the oldest element. Consumer thread only.
+     * @item: set to the removed element.
+     *
+     * Return: false if the queue is empty.
+     */
+    bool pop(T &item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail_cache) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tail_cache) {
+                return false;
+            }
+        }
+        item = m_buffer[head & (N - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*
+     * push_n - Appends as many of @count elements as fit. Producer thread only.
+     * @items: the elements to append.
+     * @count: the number of elements.
+     *
+     * Return: the number of elements appended.
+     */
+    size_t push_n(const T *items, size_t count) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (N - (tail - m_head_cache) < count) {
+            m_head_cache = m_head.load(std::memory_order_acquire);
+        }
+        count = std::min(count, N - (tail - m_head_cache));
+        for (size_t i = 0; i < count; i++) {
+            m_buffer[(tail + i) & (N - 1)] = items[i];
+        }
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    /*
+     * pop_n - Removes up to @count of the oldest elements. Consumer thread only.
+     * @items: the removed elements.
+     * @count: the maximum number of elements to remove.
+     *
+     * Return: the number of elements removed.
+     */
+    size_t pop_n(T *items, size_t count) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_tail_cache - head < count) {
+            m_tail_cache = m_tail.load(std::memory_order_acquire);
+        }
+        count = std::min(count, m_tail_cache - head);
+        for (size_t i = 0; i < count; i++) {
+            items[i] = m_buffer[(head + i) & (N - 1)];
+        }
+        m_head.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    /*
+     * size - Number of queued elements. Exact from either owning thread, approximate otherwise.
+     */
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    alignas(64) std::atomic<size_t> m_head {0};
+    size_t m_tail_cache = 0;    // consumer's view of m_tail
+    alignas(64) std::atomic<size_t> m_tail {0};
+    size_t m_head_cache = 0;    // producer's view of m_head
+    alignas(64) T m_buffer[N];
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include "cpu.h"
+
+enum class TestResult {
+    RUNNING,
+    PASSED,
+    FAILED,
+};
+
+/*
+ * TestMonitor - Watches a test ROM for its verdict so a headless run can stop right away.
+ *
+ * Two conventions are recognized:
+ * - Text printed over the serial port (Blargg's suites) containing "Passed" or "Failed".
+ * - The LD B,B breakpoint with B, C, D, E, H, L holding 3, 5, 8, 13, 21, 34 for a pass or all
+ *   0x42 for a failure (Mooneye's suites).
+ */
+class TestMonitor {
+public:
+    TestMonitor() {};
+
+    void attach(CPU &cpu);
+
+    TestResult get_result() const { return m_result; }
+    const std::string &get_output() const { return m_output; }
+
+private:
+    TestResult  m_result = TestResult::RUNNING;
+    std::string m_output;
+
+    void on_serial(uint8_t data);
+    void on_breakpoint(const CPUState &state);
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include "scheduler.h"
+
+struct TimerState {
+    uint64_t DIV_BASE = 0;          // M-cycle at which the 16-bit system counter was last zero
+    uint64_t SYNC_TIME = 0;         // M-cycle TIMA was last brought up to date
+    uint64_t RELOAD_TIME = NEVER;   // M-cycle of the last TMA reload
+    uint16_t TIMA = 0;              // 0x100 while an overflow waits for its reload
+    uint8_t  TMA = 0;
+    uint8_t  TAC = 0;
+    uint8_t  RESERVED[4] = {};
+};
+
+/*
+ * Timer - DIV, TIMA, TMA and TAC (0xFF04-0xFF07), derived from the cycle counter.
+ *
+ * DIV is the upper byte of a system counter that advances 4 per M-cycle, so it is computed from
+ * the time since the last DIV write. TIMA counts falling edges of one counter bit (selected by
+ * TAC, gated by the enable bit); the edges between two times are a division, so TIMA is only
+ * brought up to date when it is read or written. The one thing scheduled is the TMA reload one
+ * M-cycle after an overflow, which also raises the timer interrupt.
+ *
+ * Writing DIV or TAC can drop the selected bit from 1 to 0 and increment TIMA; both glitches are
+ * reproduced.
+ *
+ * Reference: https://gbdev.io/pandocs/Timer_Obscure_Behaviour.html
+ */
+class Timer {
+public:
+    Timer(Scheduler *scheduler) : m_scheduler(scheduler) {}
+
+    uint8_t read_register(uint16_t address, uint64_t now);
+    void    write_register(uint16_t address, uint8_t data, uint64_t now);
+    void    on_event(uint64_t now, uint8_t &interrupt_flags);
+
+    TimerState &get_state() { return m_state; }
+
+private:
+    TimerState m_state;
+    Scheduler *m_scheduler;
+
+    uint64_t counter(uint64_t now) const { return (now - m_state.DIV_BASE) * 4; }
+    uint64_t period() const;
+    bool     signal(uint64_t now) const;
+    void     sync(uint64_t now);
+    void     increment();
+    void     reschedule();
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+/* Reference: https://gbdev.io/pandocs/Tile_Data.html */
+class VRAM {
+public:
+    VRAM() {};
+    ~VRAM() = default;
+
+    /*
+     * read_n8 - Reads an 8-bit value from VRAM.
+     * @address: the bus address to read from (0x8000-0x9FFF).
+     *
+     *   Return: the 8-bit value read from VRAM.
+     */
+    uint8_t read_n8(uint16_t address) { return m_data[address & 0x1FFF]; }
+
+    /*
+     * write_n8 - Writes an 8-bit value to VRAM.
+     * @address: the bus address to write to (0x8000-0x9FFF).
+     * @data:    the 8-bit value to write.
+     */
+    void write_n8(uint16_t address, uint8_t data) { m_data[address & 0x1FFF] = data; }
+
+    uint8_t *data() { return m_data; }
+
+private:
+    uint8_t m_data[0x2000] = {0}; // 8KB VRAM
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+/* Reference: https://gbdev.io/pandocs/Memory_Map.html */
+class WRAM {
+public:
+    WRAM() {};
+    ~WRAM() = default;
+
+    /*
+     * read_n8 - Reads an 8-bit value from WRAM. Echo RAM (0xE000-0xFDFF) mirrors 0xC000-0xDDFF.
+     * @address: the bus address to read from.
+     *
+     *   Return: the 8-bit value read from WRAM.
+     */
+    uint8_t read_n8(uint16_t address) { return m_data[address & 0x1FFF]; }
+
+    /*
+     * write_n8 - Writes an 8-bit value to WRAM. Echo RAM (0xE000-0xFDFF) mirrors 0xC000-0xDDFF.
+     * @address: the bus address to write to.
+     * @data:    the 8-bit value to write.
+     */
+    void write_n8(uint16_t address, uint8_t data) { m_data[address & 0x1FFF] = data; }
+
+    uint8_t *data() { return m_data; }
+
+private:
+    uint8_t m_data[0x2000] = {0}; // 8KB WRAM
+};
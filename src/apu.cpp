@@ -0,0 +1,455 @@
+#include <algorithm>
+#include "apu.h"
+
+/* Register offsets from 0xFF10 */
+constexpr uint8_t NR10 = 0x00;
+constexpr uint8_t NR30 = 0x0A;
+constexpr uint8_t NR32 = 0x0C;
+constexpr uint8_t NR43 = 0x12;
+constexpr uint8_t NR50 = 0x14;
+constexpr uint8_t NR51 = 0x15;
+constexpr uint8_t NR52 = 0x16;
+constexpr uint8_t WAVE_RAM = 0x20;
+
+/* Bits ORed into reads: unused and write-only bits read back as 1 */
+static const uint8_t READ_MASK[0x20] = {
+    0x80, 0x3F, 0x00, 0xFF, 0xBF,   // NR10-NR14
+    0xFF, 0x3F, 0x00, 0xFF, 0xBF,   // NR20-NR24
+    0x7F, 0xFF, 0x9F, 0xFF, 0xBF,   // NR30-NR34
+    0xFF, 0xFF, 0x00, 0x00, 0xBF,   // NR40-NR44
+    0x00, 0x00, 0x70,               // NR50-NR52
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+static const uint8_t DUTY[4] = { 0b00000001, 0b10000001, 0b10000111, 0b01111110 };
+
+/* Per channel and side, an amplitude step of 1 at full master volume */
+constexpr int32_t OUTPUT_SCALE = 64;
+
+/* Each channel's registers start at 0xFF10 + 5 * channel (NRx0-NRx4) */
+static uint8_t base(int channel)
+{
+    return channel * 5;
+}
+
+APU::APU(Scheduler *scheduler, double sample_rate)
+    : m_scheduler(scheduler), m_sample_rate(sample_rate),
+      m_left(GB_CLOCK_RATE, sample_rate), m_right(GB_CLOCK_RATE, sample_rate)
+{
+    // The frame sequencer keeps running while the APU is off so silence is still delivered
+    m_scheduler->schedule(Event::APU, APU_SEQUENCER_CYCLES);
+}
+
+void APU::set_sample_rate(double sample_rate) {
+    m_sample_rate = sample_rate;
+    m_left.set_rates(GB_CLOCK_RATE, sample_rate);
+    m_right.set_rates(GB_CLOCK_RATE, sample_rate);
+}
+
+/*
+ * set_synthesis - Turns sample synthesis on or off. Register and frame sequencer state is kept
+ *                 either way; turning it back on restarts the waveforms from the current time.
+ * @enabled: true to synthesize samples.
+ */
+void APU::set_synthesis(bool enabled) {
+    if (enabled == m_synthesis) {
+        return;
+    }
+    m_synthesis = enabled;
+    if (!enabled) {
+        return;
+    }
+
+    for (int c = 0; c < 4; c++) {
+        m_state.CH[c].NEXT_EDGE = m_state.TIME + period(c);
+    }
+    resync();
+}
+
+/*
+ * resync - Restarts sample output at the state's TIME after the state was replaced, e.g. by a
+ *          snapshot restore. Samples not yet delivered are dropped.
+ */
+void APU::resync() {
+    if (m_suspended) {
+        return;
+    }
+    uint64_t time = m_state.TIME;
+    m_left.clear();
+    m_right.clear();
+    m_frame_start = time;
+    for (int c = 0; c < 4; c++) {
+        m_output[c][0] = 0;
+        m_output[c][1] = 0;
+    }
+    update_outputs(time);
+}
+
+/*
+ * suspend - Stops synthesis without disturbing the sample stream, for emulation that is either
+ *           thrown away afterwards (restore the state saved at this moment before resume()) or
+ *           replays time that was already heard.
+ */
+void APU::suspend() {
+    m_suspended = m_synthesis;
+    m_synthesis = false;
+}
+
+/*
+ * resume - Continues the sample stream where suspend() left it. Waveforms whose timers fell
+ *          behind while suspended restart from the current time.
+ */
+void APU::resume() {
+    for (int c = 0; m_suspended && c < 4; c++) {
+        ChannelState &ch = m_state.CH[c];
+        if (ch.ENABLED && ch.NEXT_EDGE <= m_state.TIME) {
+            ch.NEXT_EDGE = m_state.TIME + period(c);
+        }
+    }
+    m_synthesis = m_synthesis || m_suspended;
+    m_suspended = false;
+}
+
+/*
+ * read_register - Reads an audio register or wave RAM (0xFF10-0xFF3F).
+ * @address: the register address.
+ *
+ * Return: the register value with unreadable bits set.
+ */
+uint8_t APU::read_register(uint16_t address) {
+    uint8_t reg = address - 0xFF10;
+    if (reg >= WAVE_RAM) {
+        return m_state.REGS[reg];
+    }
+    if (reg == NR52) {
+        uint8_t status = m_state.REGS[NR52] & 0x80;
+        for (int c = 0; c < 4; c++) {
+            status |= m_state.CH[c].ENABLED << c;
+        }
+        return status | READ_MASK[reg];
+    }
+    return m_state.REGS[reg] | READ_MASK[reg];
+}
+
+/*
+ * write_register - Writes an audio register or wave RAM (0xFF10-0xFF3F). The channels are first
+ *                  brought up to @now so the write takes effect at the right sample.
+ * @address: the register address.
+ * @data:    the value to write.
+ * @now:     the current M-cycle.
+ */
+void APU::write_register(uint16_t address, uint8_t data, uint64_t now) {
+    uint64_t time = now * 4;
+    uint8_t reg = address - 0xFF10;
+    catch_up(time);
+
+    if (reg >= WAVE_RAM) {
+        m_state.REGS[reg] = data;
+        return;
+    }
+
+    bool powered = m_state.REGS[NR52] & 0x80;
+    if (reg == NR52) {
+        if (powered && !(data & 0x80)) {
+            power_off();
+        } else if (!powered && (data & 0x80)) {
+            m_state.SEQUENCER_STEP = 0;
+        }
+        m_state.REGS[NR52] = data & 0x80;
+        update_outputs(time);
+        return;
+    }
+    if (!powered || reg > NR52) {
+        return;
+    }
+
+    m_state.REGS[reg] = data;
+    int channel = std::min(reg / 5, 3);
+    ChannelState &ch = m_state.CH[channel];
+
+    switch (reg - base(channel)) {
+        case 1:  // NRx1: length load
+            ch.LENGTH = (channel == 2) ? 256 - data : 64 - (data & 0x3F);
+            break;
+        case 4:  // NRx4: trigger
+            if (reg < NR50 && (data & 0x80)) {
+                trigger(channel, time);
+            }
+            break;
+    }
+    if (!dac_enabled(channel)) {
+        ch.ENABLED = 0;
+    }
+    update_outputs(time);
+}
+
+/*
+ * on_event - Runs one 512 Hz frame sequencer step and delivers samples every eighth step.
+ * @now: the M-cycle the step was scheduled for.
+ */
+void APU::on_event(uint64_t now) {
+    uint64_t time = now * 4;
+    catch_up(time);
+
+    if (m_state.REGS[NR52] & 0x80) {
+        uint8_t step = m_state.SEQUENCER_STEP;
+        if ((step % 2) == 0) {
+            clock_length();
+        }
+        if (step == 2 || step == 6) {
+            clock_sweep();
+        }
+        if (step == 7) {
+            clock_envelope();
+        }
+        m_state.SEQUENCER_STEP = (step + 1) & 7;
+        update_outputs(time);
+    }
+
+    if (m_synthesis && (now / APU_SEQUENCER_CYCLES) % 8 == 0) {
+        m_left.end_frame(time - m_frame_start);
+        m_right.end_frame(time - m_frame_start);
+        m_frame_start = time;
+        deliver();
+    }
+
+    m_scheduler->schedule(Event::APU, now + APU_SEQUENCER_CYCLES);
+}
+
+/*
+ * catch_up - Advances every running channel's waveform to @time in one batch, handing each
+ *            amplitude change to the blip buffers.
+ * @time: the T-cycle to advance to.
+ */
+void APU::catch_up(uint64_t time) {
+    if (!m_synthesis) {
+        m_state.TIME = time;
+        return;
+    }
+    for (int c = 0; c < 4; c++) {
+        ChannelState &ch = m_state.CH[c];
+        if (!ch.ENABLED) {
+            continue;
+        }
+        uint64_t step = period(c);
+        while (ch.NEXT_EDGE <= time) {
+            switch (c) {
+                case 0: case 1:
+                    ch.POSITION = (ch.POSITION + 1) & 7;
+                    break;
+                case 2:
+                    ch.POSITION = (ch.POSITION + 1) & 31;
+                    break;
+                case 3: {
+                    uint16_t bit = (ch.LFSR ^ (ch.LFSR >> 1)) & 1;
+                    ch.LFSR = (ch.LFSR >> 1) | (bit << 14);
+                    if (m_state.REGS[NR43] & 0x08) {
+                        ch.LFSR = (ch.LFSR & ~0x40) | (bit << 6);
+                    }
+                    break;
+                }
+            }
+            update_output(c, ch.NEXT_EDGE);
+            ch.NEXT_EDGE += step;
+        }
+    }
+    m_state.TIME = time;
+}
+
+/*
+ * update_outputs - Hands the current amplitude of every channel to the blip buffers.
+ * @time: the T-cycle of the change.
+ */
+void APU::update_outputs(uint64_t time) {
+    if (!m_synthesis) {
+        return;
+    }
+    for (int c = 0; c < 4; c++) {
+        update_output(c, time);
+    }
+}
+
+/*
+ * update_output - Adds a delta to the blip buffers if a channel's mixed output changed.
+ * @channel: the channel (0-3).
+ * @time:    the T-cycle of the change.
+ */
+void APU::update_output(int channel, uint64_t time) {
+    int32_t level = amplitude(channel) * OUTPUT_SCALE;
+    uint8_t panning = m_state.REGS[NR51];
+    uint8_t volume = m_state.REGS[NR50];
+    int32_t left  = (panning & (0x10 << channel)) ? level * (((volume >> 4) & 7) + 1) : 0;
+    int32_t right = (panning & (0x01 << channel)) ? level * ((volume & 7) + 1) : 0;
+
+    if (left != m_output[channel][0]) {
+        m_left.add_delta(time - m_frame_start, left - m_output[channel][0]);
+        m_output[channel][0] = left;
+    }
+    if (right != m_output[channel][1]) {
+        m_right.add_delta(time - m_frame_start, right - m_output[channel][1]);
+        m_output[channel][1] = right;
+    }
+}
+
+/*
+ * amplitude - The current 4-bit DAC input of a channel, 0 when it is off.
+ */
+int APU::amplitude(int channel) const {
+    const ChannelState &ch = m_state.CH[channel];
+    if (!ch.ENABLED || !(m_state.REGS[NR52] & 0x80)) {
+        return 0;
+    }
+    switch (channel) {
+        case 0: case 1: {
+            uint8_t duty = m_state.REGS[base(channel) + 1] >> 6;
+            return ((DUTY[duty] >> (7 - ch.POSITION)) & 1) ? ch.VOLUME : 0;
+        }
+        case 2: {
+            uint8_t shift = (m_state.REGS[NR32] >> 5) & 3;
+            uint8_t sample = m_state.REGS[WAVE_RAM + ch.POSITION / 2];
+            sample = (ch.POSITION & 1) ? (sample & 0x0F) : (sample >> 4);
+            return shift ? sample >> (shift - 1) : 0;
+        }
+        default:
+            return (~ch.LFSR & 1) ? ch.VOLUME : 0;
+    }
+}
+
+void APU::trigger(int channel, uint64_t time) {
+    ChannelState &ch = m_state.CH[channel];
+    ch.ENABLED = dac_enabled(channel);
+    if (ch.LENGTH == 0) {
+        ch.LENGTH = (channel == 2) ? 256 : 64;
+    }
+    ch.NEXT_EDGE = time + period(channel);
+
+    if (channel != 2) {
+        uint8_t envelope = m_state.REGS[base(channel) + 2];
+        ch.VOLUME = envelope >> 4;
+        ch.ENVELOPE_TIMER = envelope & 7;
+    }
+    if (channel == 2) {
+        ch.POSITION = 0;
+    }
+    if (channel == 3) {
+        ch.LFSR = 0x7FFF;
+    }
+    if (channel == 0) {
+        uint8_t sweep_period = (m_state.REGS[NR10] >> 4) & 7;
+        uint8_t shift = m_state.REGS[NR10] & 7;
+        m_state.SWEEP_SHADOW = frequency(0);
+        m_state.SWEEP_TIMER = sweep_period ? sweep_period : 8;
+        m_state.SWEEP_ENABLED = sweep_period || shift;
+        if (shift && sweep_target() > 2047) {
+            ch.ENABLED = 0;
+        }
+    }
+}
+
+void APU::power_off() {
+    std::fill(m_state.REGS, m_state.REGS + NR52, 0);
+    for (ChannelState &ch : m_state.CH) {
+        ch.ENABLED = 0;
+    }
+}
+
+/*
+ * deliver - Reads every available sample pair and hands it to the audio callback.
+ */
+void APU::deliver() {
+    int16_t block[2 * 1024];
+    while (size_t frames = std::min(m_left.samples_avail(), (size_t)1024)) {
+        m_left.read_samples(block, frames, 2);
+        m_right.read_samples(block + 1, frames, 2);
+        if (m_audio_callback) {
+            m_audio_callback(block, frames);
+        }
+    }
+}
+
+void APU::clock_length() {
+    for (int c = 0; c < 4; c++) {
+        ChannelState &ch = m_state.CH[c];
+        bool length_enabled = m_state.REGS[base(c) + 4] & 0x40;
+        if (length_enabled && ch.LENGTH > 0 && --ch.LENGTH == 0) {
+            ch.ENABLED = 0;
+        }
+    }
+}
+
+void APU::clock_envelope() {
+    for (int c : { 0, 1, 3 }) {
+        ChannelState &ch = m_state.CH[c];
+        uint8_t envelope = m_state.REGS[base(c) + 2];
+        uint8_t envelope_period = envelope & 7;
+        if (!ch.ENABLED || envelope_period == 0) {
+            continue;
+        }
+        if (ch.ENVELOPE_TIMER > 0 && --ch.ENVELOPE_TIMER > 0) {
+            continue;
+        }
+        ch.ENVELOPE_TIMER = envelope_period;
+        if ((envelope & 0x08) && ch.VOLUME < 15) {
+            ch.VOLUME++;
+        } else if (!(envelope & 0x08) && ch.VOLUME > 0) {
+            ch.VOLUME--;
+        }
+    }
+}
+
+void APU::clock_sweep() {
+    if (--m_state.SWEEP_TIMER > 0) {
+        return;
+    }
+    uint8_t sweep_period = (m_state.REGS[NR10] >> 4) & 7;
+    uint8_t shift = m_state.REGS[NR10] & 7;
+    m_state.SWEEP_TIMER = sweep_period ? sweep_period : 8;
+    if (!m_state.SWEEP_ENABLED || sweep_period == 0) {
+        return;
+    }
+
+    uint16_t target = sweep_target();
+    if (target > 2047) {
+        m_state.CH[0].ENABLED = 0;
+    } else if (shift) {
+        m_state.SWEEP_SHADOW = target;
+        m_state.REGS[3] = target & 0xFF;
+        m_state.REGS[4] = (m_state.REGS[4] & ~0x07) | (target >> 8);
+        if (sweep_target() > 2047) {
+            m_state.CH[0].ENABLED = 0;
+        }
+    }
+}
+
+uint16_t APU::sweep_target() {
+    uint16_t delta = m_state.SWEEP_SHADOW >> (m_state.REGS[NR10] & 7);
+    return (m_state.REGS[NR10] & 0x08) ? m_state.SWEEP_SHADOW - delta : m_state.SWEEP_SHADOW + delta;
+}
+
+bool APU::dac_enabled(int channel) const {
+    if (channel == 2) {
+        return m_state.REGS[NR30] & 0x80;
+    }
+    return m_state.REGS[base(channel) + 2] & 0xF8;
+}
+
+uint16_t APU::frequency(int channel) const {
+    return m_state.REGS[base(channel) + 3] | ((m_state.REGS[base(channel) + 4] & 0x07) << 8);
+}
+
+/*
+ * period - T-cycles between two waveform steps of a channel.
+ */
+uint64_t APU::period(int channel) const {
+    switch (channel) {
+        case 0: case 1:
+            return (2048 - frequency(channel)) * 4;
+        case 2:
+            return (2048 - frequency(channel)) * 2;
+        default: {
+            uint8_t nr43 = m_state.REGS[NR43];
+            uint8_t divisor = nr43 & 0x07;
+            return (uint64_t)(divisor ? divisor * 16 : 8) << (nr43 >> 4);
+        }
+    }
+}
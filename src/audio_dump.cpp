@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include "audio_dump.h"
+
+constexpr size_t WAV_HEADER_SIZE = 44;
+
+AudioDump::~AudioDump() {
+    close();
+}
+
+/*
+ * open - Creates the output file and starts the writer thread.
+ * @filename:    the file to create.
+ * @format:      WAV or raw PCM.
+ * @sample_rate: the sample rate recorded in the WAV header.
+ *
+ * Return: false if the file could not be created.
+ */
+bool AudioDump::open(const std::string &filename, AudioFileFormat format, uint32_t sample_rate) {
+    close();
+    m_file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        return false;
+    }
+    m_format = format;
+    m_sample_rate = sample_rate;
+    m_frames = 0;
+    m_stalls = 0;
+    m_failed = false;
+    if (m_format == AudioFileFormat::WAV) {
+        write_header();  // Sizes are patched in close()
+    }
+
+    m_chunks = std::make_unique<Chunk[]>(CHUNK_COUNT);
+    for (uint32_t i = 1; i < CHUNK_COUNT; i++) {
+        m_free.push(i);
+    }
+    m_current_index = 0;
+    m_current = &m_chunks[0];
+    m_current->frames = 0;
+
+    m_running.store(true, std::memory_order_release);
+    m_thread = std::thread(&AudioDump::run, this);
+    return true;
+}
+
+/*
+ * write - Appends samples to the dump. Emulation thread only; usable as an audio callback.
+ * @samples: interleaved stereo samples.
+ * @frames:  the number of sample pairs.
+ */
+void AudioDump::write(const int16_t *samples, size_t frames) {
+    if (!m_current) {
+        return;
+    }
+    m_frames += frames;
+    while (frames > 0) {
+        size_t count = std::min(frames, CHUNK_FRAMES - m_current->frames);
+        std::memcpy(&m_current->samples[m_current->frames * 2], samples, count * 2 * sizeof(int16_t));
+        m_current->frames += count;
+        samples += count * 2;
+        frames -= count;
+        if (m_current->frames == CHUNK_FRAMES) {
+            submit();
+        }
+    }
+}
+
+/*
+ * submit - Hands the current chunk to the writer and takes a free one.
+ */
+void AudioDump::submit() {
+    m_full.push(m_current_index);
+    if (!m_free.pop(m_current_index)) {
+        m_stalls++;
+        while (!m_free.pop(m_current_index)) {
+            std::this_thread::yield();
+        }
+    }
+    m_current = &m_chunks[m_current_index];
+    m_current->frames = 0;
+}
+
+/*
+ * close - Writes what is left, stops the writer thread and finishes the file.
+ *
+ * Return: false if any of the dump could not be written, e.g. because the disk is full.
+ */
+bool AudioDump::close() {
+    if (!m_current) {
+        return true;
+    }
+    if (m_current->frames > 0) {
+        m_full.push(m_current_index);
+    }
+    m_current = nullptr;
+    m_running.store(false, std::memory_order_release);
+    m_thread.join();
+
+    if (m_format == AudioFileFormat::WAV) {
+        m_file.seekp(0);
+        write_header();
+    }
+    m_file.close();
+    if (!m_file) {
+        m_failed = true;
+    }
+    if (m_failed) {
+        std::cerr << "Error: Unable to write audio dump" << std::endl;
+    }
+    m_chunks.reset();
+    uint32_t index;
+    while (m_free.pop(index)) {}
+    return !m_failed;
+}
+
+void AudioDump::run() {
+    uint32_t index;
+    while (true) {
+        if (!m_full.pop(index)) {
+            if (!m_running.load(std::memory_order_acquire) && m_full.size() == 0) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        const Chunk &chunk = m_chunks[index];
+        // After a failure the chunks are still recycled, so the emulation never waits on them
+        if (!m_file.write(reinterpret_cast<const char *>(chunk.samples), chunk.frames * 2 * sizeof(int16_t))) {
+            m_failed = true;
+        }
+        m_free.push(index);
+    }
+    if (!m_file.flush()) {
+        m_failed = true;
+    }
+}
+
+static void put_u16(uint8_t *p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t value) {
+    put_u16(p, value & 0xFFFF);
+    put_u16(p + 2, value >> 16);
+}
+
+/*
+ * write_header - Writes the canonical 44-byte header of a 16-bit stereo PCM WAV file.
+ *
+ * Reference: http://soundfile.sapp.org/doc/WaveFormat/
+ */
+void AudioDump::write_header() {
+    uint32_t data_size = (uint32_t)std::min<uint64_t>(m_frames * 4, UINT32_MAX - WAV_HEADER_SIZE);
+    uint8_t header[WAV_HEADER_SIZE];
+    std::memcpy(header, "RIFF", 4);
+    put_u32(header + 4, 36 + data_size);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    put_u32(header + 16, 16);                   // fmt chunk size
+    put_u16(header + 20, 1);                    // PCM
+    put_u16(header + 22, 2);                    // Channels
+    put_u32(header + 24, m_sample_rate);
+    put_u32(header + 28, m_sample_rate * 4);    // Byte rate
+    put_u16(header + 32, 4);                    // Block align
+    put_u16(header + 34, 16);                   // Bits per sample
+    std::memcpy(header + 36, "data", 4);
+    put_u32(header + 40, data_size);
+    m_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+}
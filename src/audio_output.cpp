@@ -0,0 +1,59 @@
+#include <algorithm>
+#include "audio_output.h"
+
+AudioOutput::AudioOutput(double input_rate, double output_rate)
+    : m_resampler(input_rate, output_rate)
+{
+}
+
+/*
+ * set_rate_control - Turns dynamic rate control on or off. Emulation thread only.
+ * @enabled:       true to steer the ratio by the fill level.
+ * @max_deviation: the largest relative change of the ratio, reached at an empty or doubled ring.
+ */
+void AudioOutput::set_rate_control(bool enabled, double max_deviation) {
+    m_rate_control = enabled;
+    m_max_deviation = max_deviation;
+    if (!enabled) {
+        m_resampler.set_ratio(m_resampler.get_nominal_ratio());
+    }
+}
+
+/*
+ * write - Resamples a block and queues it for the sink. Emulation thread only.
+ * @samples: interleaved stereo samples at the input rate.
+ * @frames:  the number of sample pairs.
+ */
+void AudioOutput::write(const int16_t *samples, size_t frames) {
+    if (m_rate_control) {
+        // Above the target the sink is slower than us: consume more input per output sample
+        double error = ((double)fill_level() - m_target_fill) / m_target_fill;
+        error = std::clamp(error, -1.0, 1.0);
+        m_resampler.set_ratio(m_resampler.get_nominal_ratio() * (1 + m_max_deviation * error));
+    }
+
+    size_t room = (size_t)(frames / m_resampler.get_ratio()) + 2;
+    m_scratch.resize(room * 2);
+    size_t produced = m_resampler.process(samples, frames, m_scratch.data(), room);
+
+    size_t queued = m_ring.push_n(m_scratch.data(), produced * 2) / 2;
+    if (queued < produced) {
+        m_dropped.fetch_add(produced - queued, std::memory_order_relaxed);
+    }
+}
+
+/*
+ * read - Takes queued samples, padding with silence if the ring runs dry. Sink thread only.
+ * @out:    the interleaved stereo output.
+ * @frames: the number of sample pairs wanted.
+ *
+ * Return: the number of pairs that came from the ring; the rest of @out is silence.
+ */
+size_t AudioOutput::read(int16_t *out, size_t frames) {
+    size_t got = m_ring.pop_n(out, frames * 2) / 2;
+    if (got < frames) {
+        std::fill(out + got * 2, out + frames * 2, 0);
+        m_underruns.fetch_add(frames - got, std::memory_order_relaxed);
+    }
+    return got;
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "blip_buffer.h"
+
+BlipBuffer::BlipBuffer(double clock_rate, double sample_rate, size_t capacity)
+    : m_buffer(capacity + KERNEL_TAPS, 0)
+{
+    set_rates(clock_rate, sample_rate);
+
+    /* Blackman-windowed sinc steps, one per sub-sample phase, each summing to exactly 1 << 15 */
+    const double cutoff = 0.9;
+    for (int phase = 0; phase < PHASES; phase++) {
+        double center = KERNEL_TAPS / 2 + (double)phase / PHASES;
+        double taps[KERNEL_TAPS];
+        double sum = 0;
+        for (int i = 0; i < KERNEL_TAPS; i++) {
+            double x = i - center;
+            double sinc = (x == 0) ? 1.0 : std::sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+            double u = x / KERNEL_TAPS;
+            double window = 0.42 + 0.5 * std::cos(2 * M_PI * u) + 0.08 * std::cos(4 * M_PI * u);
+            taps[i] = sinc * window;
+            sum += taps[i];
+        }
+        int total = 0;
+        for (int i = 0; i < KERNEL_TAPS; i++) {
+            m_kernel[phase][i] = (int16_t)std::lround(taps[i] / sum * 32768);
+            total += m_kernel[phase][i];
+        }
+        m_kernel[phase][KERNEL_TAPS / 2] += 32768 - total;
+    }
+}
+
+/*
+ * set_rates - Sets the input clock rate and the output sample rate.
+ * @clock_rate:  the clocks per second of the times passed to add_delta().
+ * @sample_rate: the output samples per second.
+ */
+void BlipBuffer::set_rates(double clock_rate, double sample_rate) {
+    m_factor = (uint64_t)std::llround(sample_rate / clock_rate * 4294967296.0);
+}
+
+void BlipBuffer::clear() {
+    std::fill(m_buffer.begin(), m_buffer.end(), 0);
+    m_offset = 0;
+    m_avail = 0;
+    m_integrator = 0;
+}
+
+/*
+ * end_frame - Ends the current frame, making every sample before @time readable.
+ * @time: the length of the frame in clocks; the next frame starts there.
+ */
+void BlipBuffer::end_frame(uint64_t time) {
+    m_offset += time * m_factor;
+    m_avail = std::min(m_avail + (size_t)(m_offset >> 32), m_buffer.size() - KERNEL_TAPS);
+    m_offset &= 0xFFFFFFFF;
+}
+
+/*
+ * read_samples - Integrates and removes up to @count samples.
+ * @out:    the output samples.
+ * @count:  the maximum number of samples to read.
+ * @stride: the distance between output samples, 2 to interleave into a stereo buffer.
+ *
+ * Return: the number of samples read.
+ */
+size_t BlipBuffer::read_samples(int16_t *out, size_t count, size_t stride) {
+    count = std::min(count, m_avail);
+    int32_t sum = m_integrator;
+    for (size_t i = 0; i < count; i++) {
+        sum += m_buffer[i];
+        int32_t sample = sum >> 15;
+        out[i * stride] = (int16_t)std::clamp(sample, -32768, 32767);
+        sum -= sample << 6;  // High-pass: removes the DC offset of the unipolar channels
+    }
+    m_integrator = sum;
+
+    size_t remaining = m_avail - count + KERNEL_TAPS;
+    std::memmove(m_buffer.data(), m_buffer.data() + count, remaining * sizeof(int32_t));
+    std::fill(m_buffer.begin() + remaining, m_buffer.begin() + remaining + count, 0);
+    m_avail -= count;
+    return count;
+}
@@ -1,80 +1,418 @@
+#include <algorithm>
+#include <cstring>
 #include "bus.h"
 
 Bus::Bus() {
     m_cartridge = std::make_unique<ROM>();
-    // m_vram = std::make_unique<VRAM>();
-    // m_wram = std::make_unique<WRAM>();
-    // m_oam = std::make_unique<OAM>();
-    // m_io = std::make_unique<IO>();
-    // m_hram = std::make_unique<HRAM>();
+    init();
 }
 
-uint8_t Bus::read_n8(uint16_t address) {
+Bus::Bus(ROM *cartridge) : m_cartridge(cartridge) {
+    init();
+}
+
+void Bus::init() {
+    m_vram = std::make_unique<VRAM>();
+    m_wram = std::make_unique<WRAM>();
+    m_oam = std::make_unique<OAM>();
+    m_io = std::make_unique<IO>();
+    m_joypad = std::make_unique<Joypad>();
+    m_hram = std::make_unique<HRAM>();
+    m_ppu = std::make_unique<PPU>(m_vram.get(), m_oam.get(), &m_scheduler);
+    m_apu = std::make_unique<APU>(&m_scheduler);
+    m_timer = std::make_unique<Timer>(&m_scheduler);
+    m_serial = std::make_unique<Serial>(&m_scheduler);
+    m_dma = std::make_unique<DMA>(this);
+}
+
+/*
+ * get_page - Finds the memory behind a 256-byte page of the address space, for block transfers.
+ * @address: any address in the page.
+ *
+ * Return: the first byte of the page, or nullptr if the page is not plain memory (OAM, IO, HRAM).
+ */
+uint8_t *Bus::get_page(uint16_t address) {
+    address &= 0xFF00;
     if (address < 0x8000) {
+        return m_cartridge->data() + address;
+    } else if (address < 0xA000) {
+        return m_vram->data() + (address & 0x1FFF);
+    } else if (address < 0xC000) {
+        return m_cartridge->ram() + (address & 0x1FFF);
+    } else if (address < 0xFE00) {
+        return m_wram->data() + (address & 0x1FFF);
+    }
+    return nullptr;
+}
+
+/*
+ * get_section - Finds the live state behind one section of a snapshot.
+ * @section: the section.
+ *
+ * Return: the state, SNAPSHOT_SECTIONS[@section].size bytes.
+ */
+void *Bus::get_section(Section section) {
+    switch (section) {
+        case Section::CPU:       return m_cpu;
+        case Section::SCHEDULER: return &m_scheduler.get_state();
+        case Section::PPU:       return &m_ppu->get_state();
+        case Section::APU:       return &m_apu->get_state();
+        case Section::TIMER:     return &m_timer->get_state();
+        case Section::SERIAL:    return &m_serial->get_state();
+        case Section::DMA:       return &m_dma->get_state();
+        case Section::WRAM:      return m_wram->data();
+        case Section::VRAM:      return m_vram->data();
+        case Section::ERAM:      return m_cartridge->ram();
+        case Section::OAM:       return m_oam->data();
+        case Section::IO:        return m_io->data();
+        case Section::HRAM:      return m_hram->data();
+        case Section::JOYPAD:    return &m_joypad->get_state();
+        default:                 return nullptr;
+    }
+}
+
+/*
+ * save_snapshot - Copies the whole mutable machine state, the connected CPU's included.
+ * @snapshot: the snapshot to fill.
+ */
+void Bus::save_snapshot(Snapshot &snapshot) {
+    uint8_t *base = reinterpret_cast<uint8_t *>(&snapshot);
+    for (size_t i = 0; i < static_cast<size_t>(Section::COUNT); i++) {
+        const SectionInfo &info = SNAPSHOT_SECTIONS[i];
+        std::memcpy(base + info.offset, get_section(static_cast<Section>(i)), info.size);
+    }
+    m_dirty = DirtyPages();
+    m_dirty_base = &snapshot;
+}
+
+static void copy_pages(uint8_t *to, const uint8_t *from, uint32_t pages) {
+    while (pages) {
+        size_t offset = __builtin_ctz(pages) * 0x100;
+        std::memcpy(to + offset, from + offset, 0x100);
+        pages &= pages - 1;
+    }
+}
+
+/*
+ * copy_dirty - Copies what can differ between the live state and m_dirty_base: every section
+ *              but RAM in full, and only the dirty pages of RAM.
+ * @snapshot: the bytes of m_dirty_base.
+ * @save:     true to copy into the snapshot, false to copy out of it.
+ */
+void Bus::copy_dirty(uint8_t *snapshot, bool save) {
+    for (size_t i = 0; i < static_cast<size_t>(Section::COUNT); i++) {
+        const SectionInfo &info = SNAPSHOT_SECTIONS[i];
+        uint8_t *live = static_cast<uint8_t *>(get_section(static_cast<Section>(i)));
+        uint8_t *to = save ? snapshot + info.offset : live;
+        const uint8_t *from = save ? live : snapshot + info.offset;
+        switch (static_cast<Section>(i)) {
+            case Section::WRAM:
+                copy_pages(to, from, m_dirty.WRAM);
+                break;
+            case Section::VRAM:
+                copy_pages(to, from, m_dirty.VRAM);
+                break;
+            case Section::ERAM:
+                copy_pages(to, from, m_dirty.ERAM);
+                break;
+            case Section::HRAM:
+                if (m_dirty.HRAM) {
+                    std::memcpy(to, from, info.size);
+                }
+                break;
+            default:
+                std::memcpy(to, from, info.size);
+                break;
+        }
+    }
+}
+
+/*
+ * update_snapshot - Brings the snapshot last saved or loaded up to date, copying only the RAM
+ *                   pages written through the bus since. Any other snapshot is saved in full.
+ * @snapshot: the snapshot to update. It must not have been modified since it was saved.
+ */
+void Bus::update_snapshot(Snapshot &snapshot) {
+    if (&snapshot != m_dirty_base) {
+        save_snapshot(snapshot);
+        return;
+    }
+    copy_dirty(reinterpret_cast<uint8_t *>(&snapshot), true);
+    m_dirty = DirtyPages();
+}
+
+/*
+ * mark_dirty - Marks the RAM pages of a block written behind the bus's back, e.g. by DMA.
+ * @address: the bus address of the first byte.
+ * @length:  the number of bytes, not crossing the end of the region.
+ */
+void Bus::mark_dirty(uint16_t address, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    uint32_t first = (address >> 8) & 0x1F;
+    uint32_t last = ((address + length - 1) >> 8) & 0x1F;
+    uint32_t pages = (last == 31 ? ~0u : (2u << last) - 1) & ~((1u << first) - 1);
+    uint32_t DirtyPages::*region;
+    if (address >= 0x8000 && address < 0xA000) {
+        region = &DirtyPages::VRAM;
+    } else if (address >= 0xA000 && address < 0xC000) {
+        region = &DirtyPages::ERAM;
+    } else if (address >= 0xC000 && address < 0xFE00) {
+        region = &DirtyPages::WRAM;
+    } else if (address >= 0xFF80) {
+        region = &DirtyPages::HRAM;
+        pages = 1;
+    } else {
+        return;
+    }
+    m_dirty.*region |= pages;
+    m_written.*region |= pages;
+}
+
+/*
+ * take_written_pages - Reports the RAM pages written since the last call, independently of the
+ *                      pages snapshots track. A restore counts as writing every page.
+ *
+ * Return: the pages, which are then considered clean.
+ */
+DirtyPages Bus::take_written_pages() {
+    DirtyPages written = m_written;
+    m_written = DirtyPages();
+    return written;
+}
+
+/*
+ * revert_snapshot - Returns to the snapshot last saved or loaded, copying back only the RAM pages
+ *                   written through the bus since. Any other snapshot is loaded in full.
+ * @snapshot: the snapshot to restore. It must not have been modified since it was saved.
+ */
+void Bus::revert_snapshot(const Snapshot &snapshot) {
+    if (&snapshot != m_dirty_base) {
+        load_snapshot(snapshot);
+        return;
+    }
+    DirtyPages written = m_written;
+    written.WRAM |= m_dirty.WRAM;
+    written.VRAM |= m_dirty.VRAM;
+    written.ERAM |= m_dirty.ERAM;
+    written.HRAM |= m_dirty.HRAM;
+    copy_dirty(reinterpret_cast<uint8_t *>(const_cast<Snapshot *>(&snapshot)), false);
+    finish_restore();
+    m_dirty_base = &snapshot;
+    m_written = written;
+}
+
+/*
+ * load_snapshot - Replaces the whole mutable machine state, the connected CPU's included. Audio
+ *                 and the pipelined renderer restart from the restored state.
+ * @snapshot: the snapshot to restore.
+ */
+void Bus::load_snapshot(const Snapshot &snapshot) {
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(&snapshot);
+    for (size_t i = 0; i < static_cast<size_t>(Section::COUNT); i++) {
+        const SectionInfo &info = SNAPSHOT_SECTIONS[i];
+        std::memcpy(get_section(static_cast<Section>(i)), base + info.offset, info.size);
+    }
+    finish_restore();
+    m_dirty_base = &snapshot;
+}
+
+/*
+ * restore_section - Replaces one section of the machine state. Bytes past @size, which an older
+ *                   layout of the section did not have, are reset to their defaults. Call
+ *                   finish_restore() after the last section.
+ * @section: the section.
+ * @data:    the section's bytes.
+ * @size:    the number of bytes; anything past the current layout is ignored.
+ */
+void Bus::restore_section(Section section, const void *data, size_t size) {
+    static const Snapshot defaults {};
+    const SectionInfo &info = SNAPSHOT_SECTIONS[static_cast<size_t>(section)];
+    uint8_t *live = static_cast<uint8_t *>(get_section(section));
+    size_t known = std::min(size, info.size);
+    if (known) {
+        std::memcpy(live, data, known);
+    }
+    std::memcpy(live + known, reinterpret_cast<const uint8_t *>(&defaults) + info.offset + known, info.size - known);
+}
+
+/*
+ * finish_restore - Lets the parts of the machine that cache state catch up with a restore.
+ */
+void Bus::finish_restore() {
+    m_dirty = DirtyPages();
+    m_dirty_base = nullptr;
+    m_written = DirtyPages { ~0u, ~0u, ~0u, 1 };
+
+    m_apu->resync();
+    m_ppu->resync();
+}
+
+uint8_t Bus::read_n8(uint16_t address) {
+    if (address < 0xFF00 && m_dma->blocks(m_cpu->MCYCLES)) {
+        // OAM DMA owns the bus
+        return 0xFF;
+    } else if (address < 0x8000) {
         // ROM
         return m_cartridge->read_n8(address);
-    } // else if (address < 0xA000) {
-//        // VRAM
-//        return m_vram->read_n8(address);
-//    } else if (address < 0xC000) {
-//        // External RAM
-//        return m_wram->read_n8(address);
-//    } else if (address < 0xE000) {
-//        // WRAM
-//        return m_wram->read_n8(address);
-//    } else if (address < 0xFE00) {
-//        // Echo RAM
-//        return m_wram->read_n8(address);
-//    } else if (address < 0xFF00) {
-//        // OAM
-//        return m_oam->read_n8(address);
-//    } else if (address < 0xFF80) {
-//        // IO Registers
-//        return m_io->read_n8(address);
-//    } else {
-//        // HRAM
-//        return m_wram->read_n8(address);
-//    }
+    } else if (address < 0xA000) {
+        // VRAM
+        return m_vram->read_n8(address);
+    } else if (address < 0xC000) {
+        // External RAM
+        return m_cartridge->read_ram_n8(address);
+    } else if (address < 0xE000) {
+        // WRAM
+        return m_wram->read_n8(address);
+    } else if (address < 0xFE00) {
+        // Echo RAM
+        return m_wram->read_n8(address);
+    } else if (address < 0xFF00) {
+        // OAM
+        return m_oam->read_n8(address);
+    } else if (address < 0xFF80) {
+        // IO Registers
+        if (address == 0xFF00) {
+            return m_joypad->read_register();
+        } else if (address == 0xFF01 || address == 0xFF02) {
+            return m_serial->read_register(address);
+        } else if (address >= 0xFF04 && address <= 0xFF07) {
+            return m_timer->read_register(address, m_cpu->MCYCLES);
+        } else if (address == 0xFF0F) {
+            return 0xE0 | m_cpu->IF;
+        } else if (address >= 0xFF10 && address <= 0xFF3F) {
+            return m_apu->read_register(address);
+        } else if (address == 0xFF46 || (address >= 0xFF51 && address <= 0xFF55)) {
+            return m_dma->read_register(address);
+        } else if (address >= 0xFF40 && address <= 0xFF4B) {
+            return m_ppu->read_register(address);
+        }
+        return m_io->read_n8(address);
+    } else if (address < 0xFFFF) {
+        // HRAM
+        return m_hram->read_n8(address);
+    } else {
+        // Interrupt Enable
+        return m_cpu->IE;
+    }
 }
 
 uint16_t Bus::read_n16(uint16_t address) {
-    if (address < 0x8000) {
+    if (address < 0x7FFF && !m_dma->blocks(m_cpu->MCYCLES)) {
         // ROM
         return m_cartridge->read_n16(address);
-    } // else if (address < 0xA000) {
-//        // VRAM
-//        return m_vram->read_n8(address);
-//    } else if (address < 0xC000) {
-//        // External RAM
-//        return m_wram->read_n8(address);
-//    } else if (address < 0xE000) {
-//        // WRAM
-//        return m_wram->read_n8(address);
-//    } else if (address < 0xFE00) {
-//        // Echo RAM
-//        return m_wram->read_n8(address);
-//    } else if (address < 0xFF00) {
-//        // OAM
-//        return m_oam->read_n8(address);
-//    } else if (address < 0xFF80) {
-//        // IO Registers
-//        return m_io->read_n8(address);
-//    } else {
-//        // HRAM
-//        return m_wram->read_n8(address);
-//    }
+    }
+    return read_n8(address) | (read_n8(address + 1) << 8);
 }
 
 void Bus::write_n8(uint16_t address, uint8_t data) {
-    if (address < 0x8000) {
+    if (address < 0xFF00 && m_dma->blocks(m_cpu->MCYCLES)) {
+        // OAM DMA owns the bus
+        return;
+    } else if (address < 0x8000) {
         // ROM
         m_cartridge->write_n8(address, data);
+    } else if (address < 0xA000) {
+        // VRAM
+        m_vram->write_n8(address, data);
+        mark_page(&DirtyPages::VRAM, address);
+        m_ppu->record_write(m_cpu->MCYCLES, address, data);
+    } else if (address < 0xC000) {
+        // External RAM
+        m_cartridge->write_ram_n8(address, data);
+        mark_page(&DirtyPages::ERAM, address);
+    } else if (address < 0xE000) {
+        // WRAM
+        m_wram->write_n8(address, data);
+        mark_page(&DirtyPages::WRAM, address);
+    } else if (address < 0xFE00) {
+        // Echo RAM
+        m_wram->write_n8(address, data);
+        mark_page(&DirtyPages::WRAM, address);
+    } else if (address < 0xFF00) {
+        // OAM
+        m_oam->write_n8(address, data);
+        m_ppu->record_write(m_cpu->MCYCLES, address, data);
+    } else if (address < 0xFF80) {
+        // IO Registers
+        if (address == 0xFF00) {
+            m_joypad->write_register(data);
+        } else if (address == 0xFF01 || address == 0xFF02) {
+            m_serial->write_register(address, data, m_cpu->MCYCLES);
+        } else if (address >= 0xFF04 && address <= 0xFF07) {
+            m_timer->write_register(address, data, m_cpu->MCYCLES);
+        } else if (address == 0xFF0F) {
+            m_cpu->IF = data & 0x1F;
+        } else if (address >= 0xFF10 && address <= 0xFF3F) {
+            m_apu->write_register(address, data, m_cpu->MCYCLES);
+        } else if (address == 0xFF46 || (address >= 0xFF51 && address <= 0xFF55)) {
+            m_dma->write_register(address, data, m_cpu->MCYCLES);
+        } else if (address >= 0xFF40 && address <= 0xFF4B) {
+            m_ppu->write_register(address, data, m_cpu->MCYCLES);
+        } else {
+            m_io->write_n8(address, data);
+        }
+    } else if (address < 0xFFFF) {
+        // HRAM
+        m_hram->write_n8(address, data);
+        m_dirty.HRAM = 1;
+        m_written.HRAM = 1;
+    } else {
+        // Interrupt Enable
+        m_cpu->IE = data;
     }
 }
 
 void Bus::write_n16(uint16_t address, uint16_t data) {
-    if (address < 0x8000) {
+    if (address < 0x7FFF && !m_dma->blocks(m_cpu->MCYCLES)) {
         // ROM
         m_cartridge->write_n16(address, data);
+    } else {
+        write_n8(address, data & 0xFF);
+        write_n8(address + 1, data >> 8);
+    }
+}
+
+void Bus::run_events() {
+    Event event;
+    uint64_t when;
+    while (m_scheduler.pop(m_cpu->MCYCLES, event, when)) {
+        switch (event) {
+            case Event::PPU:
+                m_ppu->on_event(when, m_cpu->IF);
+                if (m_dma->hblank_active() && m_ppu->get_state().MODE == PPU_MODE_HBLANK) {
+                    m_dma->on_hblank(when);
+                }
+                break;
+            case Event::APU:
+                m_apu->on_event(when);
+                break;
+            case Event::TIMER:
+                m_timer->on_event(when, m_cpu->IF);
+                break;
+            case Event::SERIAL:
+                m_serial->on_event(when, m_cpu->IF);
+                break;
+            case Event::LINK:
+                m_serial->on_link(when, m_cpu->IF);
+                break;
+            default:
+                break;
+        }
     }
 }
+
+APU *Bus::get_apu() { return m_apu.get(); }
+ROM *Bus::get_cartridge() { return m_cartridge.get(); }
+DMA *Bus::get_dma() { return m_dma.get(); }
+IO *Bus::get_io() { return m_io.get(); }
+Joypad *Bus::get_joypad() { return m_joypad.get(); }
+OAM *Bus::get_oam() { return m_oam.get(); }
+PPU *Bus::get_ppu() { return m_ppu.get(); }
+VRAM *Bus::get_vram() { return m_vram.get(); }
+WRAM *Bus::get_wram() { return m_wram.get(); }
+HRAM *Bus::get_hram() { return m_hram.get(); }
+Serial *Bus::get_serial() { return m_serial.get(); }
+Timer *Bus::get_timer() { return m_timer.get(); }
+Scheduler *Bus::get_scheduler() { return &m_scheduler; }
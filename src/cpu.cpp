@@ -1,7 +1,7 @@
 #include <iostream>
 #include "cpu.h"
 
-#define DEBUG
+// #define DEBUG
 
 /*
  * reset() - Resets the CPU registers and flags to their initial state.
@@ -17,7 +17,27 @@ void CPU::reset() {
     m_state.IME = 0;
     m_state.IF = 0;
     m_state.IE = 0;
+    m_state.STALL = 0;
+    m_state.WAIT = 0;
+    m_state.HALTED = 0;
     m_state.MCYCLES = 0;
+    m_state.STUCK = STUCK_NONE;
+}
+
+/*
+ * get_stuck_reason - Why the CPU can provably never make progress again.
+ *
+ * Return: the reason, or nullptr if the CPU is not stuck.
+ */
+const char *CPU::get_stuck_reason() const {
+    switch (m_state.STUCK) {
+        case STUCK_JR_LOOP:
+            return "JR to itself with interrupts disabled";
+        case STUCK_HALT:
+            return "HALT with every interrupt disabled in IE";
+        default:
+            return nullptr;
+    }
 }
 
 /*
@@ -31,15 +51,60 @@ uint8_t CPU::fetch() {
 }
 
 /*
- * step() - Executes a single CPU instruction.
+ * service_interrupts() - Handles a halted CPU and interrupt dispatch at an instruction boundary.
+ *
+ * A halted CPU wakes up once an enabled interrupt is requested, whatever IME says. Until then
+ * nothing can change before the next scheduled event, so the clock jumps straight to it.
+ *
+ * Returns:
+ *   bool: true if the M-cycle was used up here and no instruction should be fetched.
+ */
+bool CPU::service_interrupts() {
+    uint8_t pending = m_state.IE & m_state.IF & 0x1F;
+    if (m_state.HALTED) {
+        if (!pending) {
+            m_state.STALL = 0;  // The CPU is not using the bus anyway
+            uint64_t next = m_bus->get_scheduler()->next();
+            m_state.MCYCLES = (next > m_state.MCYCLES && next != NEVER) ? next : m_state.MCYCLES + 1;
+            m_bus->tick();
+            return true;
+        }
+        m_state.HALTED = 0;
+    }
+    if (!m_state.IME || !pending) {
+        return false;
+    }
+
+    /* Dispatch the highest-priority interrupt: 5 M-cycles, the last one being this step */
+    uint8_t bit = __builtin_ctz(pending);
+    m_state.IF &= ~(1 << bit);
+    m_state.IME = 0;
+    m_bus->write_n16(m_state.SP.r16 -= 2, m_state.PC.r16);
+    m_state.PC.r16 = 0x40 + bit * 8;
+    m_state.WAIT = 4;
+    m_state.MCYCLES++;
+    m_bus->tick();
+    return true;
+}
+
+/*
+ * step() - Advances the CPU by one M-cycle, executing an instruction once the previous one has
+ *          used up its cycles.
  */
 void CPU::step() {
-    if (m_cycles_to_wait > 0) {
-        m_cycles_to_wait--;
+    if (m_state.WAIT > 0) {
+        m_state.WAIT--;
         m_state.MCYCLES++;
+        m_bus->tick();
         return;
     }
 
+    if (m_state.HALTED | (m_state.IE & m_state.IF & 0x1F)) {
+        if (service_interrupts()) {
+            return;
+        }
+    }
+
     uint8_t opcode = fetch();
     uint8_t cycle_count = 0;
 
@@ -60,6 +125,9 @@ void CPU::step() {
             } else {
                 *get_r8_from_opcode(opcode) = *get_r8_from_opcode(opcode, 3);
             }
+            if (opcode == 0100 && m_breakpoint_hook) {
+                m_breakpoint_hook(m_state);
+            }
             cycle_count = 1;
             break;
 
@@ -737,6 +805,7 @@ void CPU::step() {
                     .n = 0,
                     .z = 0
                 };
+                cycle_count = 1;
                 break;
             }
 
@@ -762,6 +831,9 @@ void CPU::step() {
             {
                 int8_t offset = (int8_t)m_bus->read_n16(m_state.PC.r16++);
                 m_state.PC.r16 += offset;
+                if (offset == -2 && !(m_state.IME && (m_state.IE & 0x1F))) {
+                    m_state.STUCK = STUCK_JR_LOOP;
+                }
                 cycle_count = 3;
                 break;
             }
@@ -1054,7 +1126,12 @@ void CPU::step() {
 
         /* HALT */
         case 0166:
-            throw std::runtime_error("HALT opcode not implemented");
+            if ((m_state.IE & 0x1F) == 0) {
+                m_state.STUCK = STUCK_HALT;
+            }
+            m_state.HALTED = 1;
+            cycle_count = 1;
+            break;
 
         /* DI */
         case 0364:
@@ -1076,6 +1153,9 @@ void CPU::step() {
             throw std::runtime_error("Received unknown opcode");
     }
 
-    m_cycles_to_wait = cycle_count;
-    m_state.MCYCLES += cycle_count;
+    // A DMA started by this instruction holds the CPU off the bus until it is done
+    m_state.WAIT = cycle_count - 1 + m_state.STALL;
+    m_state.STALL = 0;
+    m_state.MCYCLES++;
+    m_bus->tick();
 }
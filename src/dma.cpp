@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstring>
+#include "bus.h"
+#include "dma.h"
+
+/*
+ * read_register - Reads FF46 or one of the VRAM DMA registers.
+ * @address: the register address.
+ *
+ * Return: the register value; FF51-FF54 are write-only and read 0xFF.
+ */
+uint8_t DMA::read_register(uint16_t address) {
+    if (address == 0xFF46) {
+        return m_state.OAM_SOURCE;
+    }
+    if (address == 0xFF55 && m_cgb) {
+        return m_state.HDMA_LENGTH;
+    }
+    return 0xFF;
+}
+
+/*
+ * write_register - Writes FF46, which starts an OAM DMA, or one of the VRAM DMA registers.
+ * @address: the register address.
+ * @data:    the value to write.
+ * @now:     the current M-cycle.
+ */
+void DMA::write_register(uint16_t address, uint8_t data, uint64_t now) {
+    if (address == 0xFF46) {
+        start_oam(data, now);
+        return;
+    }
+    if (!m_cgb) {
+        return;
+    }
+
+    switch (address) {
+        case 0xFF51:
+            m_state.HDMA_SOURCE = (m_state.HDMA_SOURCE & 0x00FF) | (data << 8);
+            break;
+        case 0xFF52:
+            m_state.HDMA_SOURCE = (m_state.HDMA_SOURCE & 0xFF00) | (data & 0xF0);
+            break;
+        case 0xFF53:
+            m_state.HDMA_DEST = (m_state.HDMA_DEST & 0x00FF) | ((data & 0x1F) << 8);
+            break;
+        case 0xFF54:
+            m_state.HDMA_DEST = (m_state.HDMA_DEST & 0x1F00) | (data & 0xF0);
+            break;
+        case 0xFF55:
+            if (hblank_active() && !(data & 0x80)) {
+                // Clearing bit 7 stops an HBlank DMA, the remaining length stays readable
+                m_state.HDMA_LENGTH |= 0x80;
+                break;
+            }
+            m_state.HDMA_LENGTH = data & 0x7F;
+            if (!(data & 0x80)) {
+                copy_blocks(m_state.HDMA_LENGTH + 1, now);
+            } else {
+                PPUState &ppu = m_bus->get_ppu()->get_state();
+                if ((ppu.LCDC & 0x80) && ppu.MODE == PPU_MODE_HBLANK) {
+                    // Started inside HBlank with the LCD on, so this one gets its block right away
+                    copy_blocks(1, now);
+                }
+            }
+            break;
+    }
+}
+
+/*
+ * on_hblank - Copies the next block of an HBlank DMA.
+ * @now: the M-cycle HBlank started at.
+ */
+void DMA::on_hblank(uint64_t now) {
+    copy_blocks(1, now);
+}
+
+/*
+ * start_oam - Copies the 160 bytes at @source * 0x100 into OAM and opens the DMA window.
+ * @source: the high byte of the source address. Pages above 0xDF read the WRAM mirror.
+ * @now:    the M-cycle FF46 was written at.
+ */
+void DMA::start_oam(uint8_t source, uint64_t now) {
+    m_state.OAM_SOURCE = source;
+    m_state.OAM_END = now + 1 + OAM_DMA_CYCLES;
+
+    uint8_t *oam = m_bus->get_oam()->data();
+    const uint8_t *page = m_bus->get_page(source << 8);
+    if (page) {
+        std::memcpy(oam, page, 0xA0);
+    } else {
+        std::memset(oam, 0xFF, 0xA0);
+    }
+    m_bus->get_ppu()->record_block(now, 0xFE00, oam, 0xA0);
+}
+
+/*
+ * copy_blocks - Copies 16-byte blocks from HDMA_SOURCE to VRAM at HDMA_DEST, one memcpy per source
+ *               page, and stalls the CPU for them.
+ * @count: the number of blocks; the copy stops early if the transfer runs out.
+ * @now:   the current M-cycle.
+ */
+void DMA::copy_blocks(unsigned count, uint64_t now) {
+    unsigned left = std::min<unsigned>(count, (m_state.HDMA_LENGTH & 0x7F) + 1);
+    uint8_t *vram = m_bus->get_vram()->data();
+    m_bus->stall(left * HDMA_BLOCK_CYCLES);
+
+    while (left > 0) {
+        // Neither the source page nor the end of VRAM can be crossed by one copy
+        unsigned bytes = std::min({ left * 16u,
+                                    0x100u - (m_state.HDMA_SOURCE & 0xFF),
+                                    0x2000u - m_state.HDMA_DEST });
+        uint8_t *target = vram + m_state.HDMA_DEST;
+        const uint8_t *page = m_bus->get_page(m_state.HDMA_SOURCE);
+        if (page) {
+            std::memcpy(target, page + (m_state.HDMA_SOURCE & 0xFF), bytes);
+        } else {
+            std::memset(target, 0xFF, bytes);
+        }
+        m_bus->mark_dirty(0x8000 + m_state.HDMA_DEST, bytes);
+        m_bus->get_ppu()->record_block(now, 0x8000 + m_state.HDMA_DEST, target, bytes);
+
+        m_state.HDMA_SOURCE += bytes;
+        m_state.HDMA_DEST = (m_state.HDMA_DEST + bytes) & 0x1FFF;
+        m_state.HDMA_LENGTH -= bytes / 16;
+        left -= bytes / 16;
+    }
+}
@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <iostream>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "fork_server.h"
+
+/*
+ * boot - Runs the machine to the fork point and snapshots it there.
+ * @point: where to stop.
+ *
+ * Return: false if the point was not reached within its cycle limit or the CPU got stuck.
+ */
+bool ForkServer::boot(const ForkPoint &point) {
+    CPUState &state = m_cpu.get_state();
+    const PPUState &ppu = m_cpu.get_bus()->get_ppu()->get_state();
+    bool use_frame = point.frame > 0 || point.pc < 0;
+
+    while (true) {
+        bool at_pc = point.pc >= 0 && state.WAIT == 0 && !state.HALTED && state.PC.r16 == point.pc;
+        if (at_pc || (use_frame && ppu.FRAMES >= point.frame)) {
+            break;
+        }
+        if (state.MCYCLES >= point.cycle_limit || m_cpu.get_stuck_reason()) {
+            std::cerr << "Error: Fork point not reached after " << state.MCYCLES << " M-cycles" << std::endl;
+            return false;
+        }
+        m_cpu.step();
+    }
+    m_cpu.get_bus()->save_snapshot(*m_snapshot);
+    return true;
+}
+
+/*
+ * acquire - Takes an instance from the pool, creating one if none is idle, and restores the
+ *           fork point into it. Safe to call from several threads.
+ *
+ * Return: the instance, to be handed back with release().
+ */
+CPU *ForkServer::acquire() {
+    CPU *cpu = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_pool_lock);
+        if (!m_idle.empty()) {
+            cpu = m_idle.back();
+            m_idle.pop_back();
+        } else {
+            ROM *rom = new ROM(*m_cpu.get_bus()->get_cartridge());
+            m_pool.push_back(std::make_unique<CPU>(new Bus(rom)));
+            cpu = m_pool.back().get();
+            cpu->get_bus()->get_ppu()->set_rendering(false);
+            cpu->get_bus()->get_apu()->set_synthesis(false);
+        }
+    }
+    cpu->reset();
+    cpu->get_bus()->load_snapshot(*m_snapshot);
+    return cpu;
+}
+
+/*
+ * release - Returns an instance to the pool and drops any callbacks the job installed.
+ * @cpu: an instance from acquire().
+ */
+void ForkServer::release(CPU *cpu) {
+    Bus *bus = cpu->get_bus();
+    cpu->set_breakpoint_hook(nullptr);
+    bus->get_serial()->set_output_callback(nullptr);
+    bus->get_ppu()->set_frame_callback(nullptr);
+    bus->get_apu()->set_audio_callback(nullptr);
+
+    std::lock_guard<std::mutex> lock(m_pool_lock);
+    m_idle.push_back(cpu);
+}
+
+/*
+ * fork_job - Runs a job in a child process that starts out as an exact copy of the booted
+ *            machine. The parent's machine is left untouched.
+ * @job: the function the child runs; its return value is the child's exit status.
+ *
+ * Return: the child's pid, or -1 if fork() failed.
+ */
+pid_t ForkServer::fork_job(const std::function<int(CPU &)> &job) {
+    // Output buffered before the fork would otherwise be written by both processes
+    std::fflush(nullptr);
+    std::cout.flush();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Error: Unable to fork a job" << std::endl;
+        return -1;
+    }
+    if (pid > 0) {
+        return pid;
+    }
+
+    int status = 1;
+    try {
+        status = job(m_cpu);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+    std::cout.flush();
+    std::fflush(nullptr);
+    _exit(status);
+}
+
+/*
+ * wait_job - Waits for a job started with fork_job() to end.
+ * @pid: the child's pid.
+ *
+ * Return: its exit status, or -1 if it did not exit normally.
+ */
+int ForkServer::wait_job(pid_t pid) {
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
@@ -0,0 +1,148 @@
+#include <cstring>
+#include "frame_output.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+size_t bytes_per_pixel(PixelFormat format)
+{
+    switch (format) {
+        case PixelFormat::RGBA8888:   return 4;
+        case PixelFormat::RGB565:     return 2;
+        case PixelFormat::GRAYSCALE8: return 1;
+    }
+    return 0;
+}
+
+FrameConverter::FrameConverter(PixelFormat format, const uint32_t palette[4]) : m_format(format) {
+    set_palette(palette);
+}
+
+/*
+ * set_palette - Rebuilds the per-format lookup tables.
+ * @palette: the 0xRRGGBB color of each shade, lightest (0) to darkest (3).
+ */
+void FrameConverter::set_palette(const uint32_t palette[4]) {
+    for (int i = 0; i < 4; i++) {
+        uint8_t r = (palette[i] >> 16) & 0xFF;
+        uint8_t g = (palette[i] >> 8) & 0xFF;
+        uint8_t b = palette[i] & 0xFF;
+        uint8_t rgba[4] = { r, g, b, 0xFF };
+        std::memcpy(&m_rgba[i], rgba, sizeof(rgba));
+        m_rgb565[i] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+        m_gray[i] = (77 * r + 150 * g + 29 * b) >> 8;
+    }
+}
+
+/*
+ * convert - Converts a frame, or only some of its lines.
+ * @frame: the frame to convert.
+ * @dst:   the first byte of the top line of the output.
+ * @pitch: the distance in bytes between output lines.
+ * @lines: the lines to convert, e.g. &frame.dirty_lines when @dst holds the previous frame;
+ *         nullptr converts every line.
+ */
+void FrameConverter::convert(const Frame &frame, void *dst, size_t pitch, const std::bitset<SCREEN_HEIGHT> *lines) const {
+    uint8_t *line = static_cast<uint8_t *>(dst);
+    for (int y = 0; y < SCREEN_HEIGHT; y++, line += pitch) {
+        if (!lines || lines->test(y)) {
+            convert_line(frame.pixels[y], line);
+        }
+    }
+}
+
+/*
+ * convert_line - Converts one line of SCREEN_WIDTH shades.
+ * @shades: the shades (0-3) of the line.
+ * @dst:    the output pixels; no alignment is required.
+ */
+void FrameConverter::convert_line(const uint8_t *shades, void *dst) const {
+    uint8_t *out = static_cast<uint8_t *>(dst);
+    int x = 0;
+
+#if defined(__SSE2__)
+    /* One compare mask per shade, widened to the output size by unpacking it with itself */
+    const __m128i shade1 = _mm_set1_epi8(1);
+    const __m128i shade2 = _mm_set1_epi8(2);
+    const __m128i shade3 = _mm_set1_epi8(3);
+
+    for (; x + 16 <= SCREEN_WIDTH; x += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(shades + x));
+        __m128i m1 = _mm_cmpeq_epi8(v, shade1);
+        __m128i m2 = _mm_cmpeq_epi8(v, shade2);
+        __m128i m3 = _mm_cmpeq_epi8(v, shade3);
+
+        switch (m_format) {
+            case PixelFormat::GRAYSCALE8: {
+                __m128i r = _mm_set1_epi8((char)m_gray[0]);
+                r = _mm_or_si128(_mm_andnot_si128(m1, r), _mm_and_si128(m1, _mm_set1_epi8((char)m_gray[1])));
+                r = _mm_or_si128(_mm_andnot_si128(m2, r), _mm_and_si128(m2, _mm_set1_epi8((char)m_gray[2])));
+                r = _mm_or_si128(_mm_andnot_si128(m3, r), _mm_and_si128(m3, _mm_set1_epi8((char)m_gray[3])));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), r);
+                break;
+            }
+
+            case PixelFormat::RGB565: {
+                __m128i c0 = _mm_set1_epi16((short)m_rgb565[0]);
+                __m128i c1 = _mm_set1_epi16((short)m_rgb565[1]);
+                __m128i c2 = _mm_set1_epi16((short)m_rgb565[2]);
+                __m128i c3 = _mm_set1_epi16((short)m_rgb565[3]);
+                for (int half = 0; half < 2; half++) {
+                    __m128i w1 = half ? _mm_unpackhi_epi8(m1, m1) : _mm_unpacklo_epi8(m1, m1);
+                    __m128i w2 = half ? _mm_unpackhi_epi8(m2, m2) : _mm_unpacklo_epi8(m2, m2);
+                    __m128i w3 = half ? _mm_unpackhi_epi8(m3, m3) : _mm_unpacklo_epi8(m3, m3);
+                    __m128i r = c0;
+                    r = _mm_or_si128(_mm_andnot_si128(w1, r), _mm_and_si128(w1, c1));
+                    r = _mm_or_si128(_mm_andnot_si128(w2, r), _mm_and_si128(w2, c2));
+                    r = _mm_or_si128(_mm_andnot_si128(w3, r), _mm_and_si128(w3, c3));
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (x + half * 8) * 2), r);
+                }
+                break;
+            }
+
+            case PixelFormat::RGBA8888: {
+                __m128i c0 = _mm_set1_epi32((int)m_rgba[0]);
+                __m128i c1 = _mm_set1_epi32((int)m_rgba[1]);
+                __m128i c2 = _mm_set1_epi32((int)m_rgba[2]);
+                __m128i c3 = _mm_set1_epi32((int)m_rgba[3]);
+                for (int half = 0; half < 2; half++) {
+                    __m128i h1 = half ? _mm_unpackhi_epi8(m1, m1) : _mm_unpacklo_epi8(m1, m1);
+                    __m128i h2 = half ? _mm_unpackhi_epi8(m2, m2) : _mm_unpacklo_epi8(m2, m2);
+                    __m128i h3 = half ? _mm_unpackhi_epi8(m3, m3) : _mm_unpacklo_epi8(m3, m3);
+                    for (int quarter = 0; quarter < 2; quarter++) {
+                        __m128i w1 = quarter ? _mm_unpackhi_epi16(h1, h1) : _mm_unpacklo_epi16(h1, h1);
+                        __m128i w2 = quarter ? _mm_unpackhi_epi16(h2, h2) : _mm_unpacklo_epi16(h2, h2);
+                        __m128i w3 = quarter ? _mm_unpackhi_epi16(h3, h3) : _mm_unpacklo_epi16(h3, h3);
+                        __m128i r = c0;
+                        r = _mm_or_si128(_mm_andnot_si128(w1, r), _mm_and_si128(w1, c1));
+                        r = _mm_or_si128(_mm_andnot_si128(w2, r), _mm_and_si128(w2, c2));
+                        r = _mm_or_si128(_mm_andnot_si128(w3, r), _mm_and_si128(w3, c3));
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + (x + half * 8 + quarter * 4) * 4), r);
+                    }
+                }
+                break;
+            }
+        }
+    }
+#endif
+
+    /* Scalar tail, and the whole line without SSE2 */
+    switch (m_format) {
+        case PixelFormat::GRAYSCALE8:
+            for (; x < SCREEN_WIDTH; x++) {
+                out[x] = m_gray[shades[x] & 0b11];
+            }
+            break;
+        case PixelFormat::RGB565:
+            for (; x < SCREEN_WIDTH; x++) {
+                std::memcpy(out + x * 2, &m_rgb565[shades[x] & 0b11], 2);
+            }
+            break;
+        case PixelFormat::RGBA8888:
+            for (; x < SCREEN_WIDTH; x++) {
+                std::memcpy(out + x * 4, &m_rgba[shades[x] & 0b11], 4);
+            }
+            break;
+    }
+}
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <iostream>
+#include "bus.h"
+#include "cpu.h"
+#include "hash.h"
+
+/*
+ * hash_machine - Hashes the CPU state and every RAM region of a machine.
+ * @cpu: the machine's CPU.
+ *
+ * Return: the 64-bit hash. ROM is not included.
+ */
+uint64_t hash_machine(CPU &cpu)
+{
+    Bus *bus = cpu.get_bus();
+    uint64_t h = xxh64(&cpu.get_state(), sizeof(CPUState));
+    h = xxh64(bus->get_vram()->data(), 0x2000, h);
+    h = xxh64(bus->get_wram()->data(), 0x2000, h);
+    h = xxh64(bus->get_cartridge()->ram(), 0x2000, h);
+    h = xxh64(bus->get_oam()->data(), 0xA0, h);
+    h = xxh64(bus->get_io()->data(), 0x80, h);
+    h = xxh64(bus->get_hram()->data(), 0x80, h);
+    return h;
+}
+
+/*
+ * hash_rom - Hashes the cartridge ROM of a machine.
+ * @cpu: the machine's CPU.
+ *
+ * Return: the 64-bit hash.
+ */
+uint64_t hash_rom(CPU &cpu)
+{
+    return xxh64(cpu.get_bus()->get_cartridge()->data(), 0x8000);
+}
+
+static void hash_pages(uint64_t *hashes, const uint8_t *memory, uint32_t pages) {
+    while (pages) {
+        size_t page = __builtin_ctz(pages);
+        hashes[page] = xxh64(memory + page * 0x100, 0x100);
+        pages &= pages - 1;
+    }
+}
+
+/*
+ * update - Brings the hash up to date with the machine.
+ * @bus: the machine, the same one on every call until invalidate().
+ *
+ * Return: the hash of the machine's current state.
+ */
+uint64_t StateHasher::update(Bus &bus)
+{
+    DirtyPages written = bus.take_written_pages();
+    if (!m_valid) {
+        written = DirtyPages { ~0u, ~0u, ~0u, 1 };
+        m_valid = true;
+    }
+    hash_pages(m_wram, bus.get_wram()->data(), written.WRAM);
+    hash_pages(m_vram, bus.get_vram()->data(), written.VRAM);
+    hash_pages(m_eram, bus.get_cartridge()->ram(), written.ERAM);
+
+    uint64_t h = 0;
+    for (size_t i = 0; i < static_cast<size_t>(Section::COUNT); i++) {
+        Section section = static_cast<Section>(i);
+        if (section != Section::WRAM && section != Section::VRAM && section != Section::ERAM) {
+            h = xxh64(bus.get_section(section), SNAPSHOT_SECTIONS[i].size, h);
+        }
+    }
+    h = xxh64(m_wram, sizeof(m_wram), h);
+    h = xxh64(m_vram, sizeof(m_vram), h);
+    return xxh64(m_eram, sizeof(m_eram), h);
+}
+
+/*
+ * open - Opens (truncates) the hash log.
+ * @filename: the file to write to.
+ *
+ * Return: false if the file could not be opened.
+ */
+bool FrameHashLog::open(const std::string &filename) {
+    m_file.open(filename, std::ios::out | std::ios::trunc);
+    if (!m_file) {
+        std::cerr << "Error: Unable to open file " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void FrameHashLog::on_frame(const Frame &frame) {
+    if (frame.dirty_lines.any() || m_last_frame == 0 || frame.number != m_last_frame + 1) {
+        m_last_hash = hash_frame(frame);
+    }
+    m_last_frame = frame.number;
+    if (m_file) {
+        char line[48];
+        int length = std::snprintf(line, sizeof(line), "%llu %016llx\n",
+                                   (unsigned long long)frame.number, (unsigned long long)m_last_hash);
+        m_file.write(line, length);
+    }
+}
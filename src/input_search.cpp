@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include "input_search.h"
+#include "run_ahead.h"
+
+/*
+ * InputSearch - Starts the worker pool.
+ * @prototype: the machine whose ROM the workers run. Its state does not matter.
+ * @threads:   the number of workers, 0 for one per hardware thread.
+ */
+InputSearch::InputSearch(CPU &prototype, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        ROM *rom = new ROM(*prototype.get_bus()->get_cartridge());
+        m_instances.push_back(std::make_unique<CPU>(new Bus(rom)));
+        m_instances.back()->get_bus()->get_ppu()->set_rendering(false);
+        m_instances.back()->get_bus()->get_apu()->set_synthesis(false);
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        m_workers.emplace_back(&InputSearch::work, this, std::ref(*m_instances[i]));
+    }
+}
+
+InputSearch::~InputSearch() {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+}
+
+/*
+ * take_state - Takes a snapshot from the recycled ones, or a new one if there are none.
+ *
+ * Return: the snapshot, to be handed back with recycle() once no longer needed.
+ */
+std::unique_ptr<Snapshot> InputSearch::take_state() {
+    if (m_free_states.empty()) {
+        return std::make_unique<Snapshot>();
+    }
+    std::unique_ptr<Snapshot> state = std::move(m_free_states.back());
+    m_free_states.pop_back();
+    return state;
+}
+
+/*
+ * recycle - Hands a kept state back for later children to reuse.
+ * @state: a SearchChild::STATE or a snapshot from take_state().
+ */
+void InputSearch::recycle(std::unique_ptr<Snapshot> state) {
+    if (state) {
+        m_free_states.push_back(std::move(state));
+    }
+}
+
+/*
+ * run_task - Runs one child on a worker's machine.
+ * @cpu:  the worker's machine.
+ * @task: the child and its parent state.
+ *
+ * Return: the number of frames run.
+ */
+unsigned InputSearch::run_task(CPU &cpu, const Task &task) {
+    SearchChild &child = *task.child;
+    Bus *bus = cpu.get_bus();
+    cpu.reset();
+    bus->load_snapshot(*task.from);
+    bus->set_buttons(child.BUTTONS);
+    unsigned frame = 0;
+    try {
+        for (; frame < m_frames && !child.FAILED; frame++) {
+            child.FAILED = !run_to_frame_end(cpu);
+        }
+        if (!child.FAILED) {
+            child.SCORE = (*m_score)(cpu);
+        }
+    } catch (const std::exception &) {
+        child.FAILED = true;
+    }
+    if (child.FAILED) {
+        child.SCORE = -std::numeric_limits<double>::infinity();
+    }
+    if (child.STATE) {
+        bus->save_snapshot(*child.STATE);
+    }
+    return frame;
+}
+
+void InputSearch::work(CPU &cpu) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(m_lock);
+    while (true) {
+        m_wake.wait(lock, [&] { return m_stopping || m_generation != seen; });
+        if (m_stopping) {
+            return;
+        }
+        seen = m_generation;
+        lock.unlock();
+
+        uint64_t frames = 0;
+        for (size_t i = m_next.fetch_add(1); i < m_tasks.size(); i = m_next.fetch_add(1)) {
+            frames += run_task(cpu, m_tasks[i]);
+        }
+
+        lock.lock();
+        m_stats.FRAMES += frames;
+        if (++m_finished == m_workers.size()) {
+            m_done.notify_one();
+        }
+    }
+}
+
+/*
+ * run_batch - Runs every task in m_tasks on the workers and waits for them.
+ */
+void InputSearch::run_batch() {
+    auto clock = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_next = 0;
+    m_finished = 0;
+    m_generation++;
+    m_wake.notify_all();
+    m_done.wait(lock, [this] { return m_finished == m_workers.size(); });
+
+    m_stats.CHILDREN += m_tasks.size();
+    m_stats.ELAPSED_NS += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - clock).count();
+}
+
+/*
+ * expand - Runs one child per input choice from a state and scores them.
+ * @from:        the parent state.
+ * @choices:     the buttons each child holds, a mask of Button per child.
+ * @frames:      the number of frames each child runs.
+ * @score:       scores the machine at the end of a child's frames; higher is better.
+ * @keep_states: whether to return each child's final state, to expand it in turn.
+ *
+ * Return: the children, in the order of @choices.
+ */
+std::vector<SearchChild> InputSearch::expand(const Snapshot &from, const std::vector<uint8_t> &choices,
+                                             unsigned frames, const Score &score, bool keep_states) {
+    std::vector<SearchChild> children(choices.size());
+    m_tasks.clear();
+    for (size_t i = 0; i < choices.size(); i++) {
+        children[i].BUTTONS = choices[i];
+        if (keep_states) {
+            children[i].STATE = take_state();
+        }
+        m_tasks.push_back(Task { &from, &children[i] });
+    }
+    m_score = &score;
+    m_frames = frames;
+    run_batch();
+    return children;
+}
+
+/*
+ * beam_search - Searches the tree of input choices breadth first, keeping only the best states
+ *               of every level.
+ * @from:       the root state.
+ * @choices:    the buttons to try at every step.
+ * @frames:     the number of frames each step holds its buttons for.
+ * @depth:      the number of steps.
+ * @beam_width: how many of the best states of a level are expanded into the next one.
+ * @score:      as for expand().
+ *
+ * Return: the best-scoring input sequence of @depth steps. Its SCORE is -infinity and INPUTS
+ *         empty if every sequence failed.
+ */
+SearchPath InputSearch::beam_search(const Snapshot &from, const std::vector<uint8_t> &choices, unsigned frames,
+                                    unsigned depth, unsigned beam_width, const Score &score) {
+    struct Node {
+        std::unique_ptr<Snapshot> state;
+        SearchPath path;
+    };
+    std::vector<Node> beam(1);
+    size_t count = choices.size();
+
+    for (unsigned step = 0; step < depth && !beam.empty(); step++) {
+        bool keep_states = step + 1 < depth;
+        std::vector<SearchChild> children(beam.size() * count);
+        m_tasks.clear();
+        for (size_t i = 0; i < children.size(); i++) {
+            const Node &parent = beam[i / count];
+            children[i].BUTTONS = choices[i % count];
+            if (keep_states) {
+                children[i].STATE = take_state();
+            }
+            m_tasks.push_back(Task { parent.state ? parent.state.get() : &from, &children[i] });
+        }
+        m_score = &score;
+        m_frames = frames;
+        run_batch();
+
+        std::vector<size_t> order(children.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&children](size_t a, size_t b) {
+            return children[a].SCORE > children[b].SCORE;
+        });
+
+        std::vector<Node> next;
+        for (size_t i : order) {
+            SearchChild &child = children[i];
+            if (next.size() < beam_width && !child.FAILED) {
+                Node node { std::move(child.STATE), beam[i / count].path };
+                node.path.INPUTS.push_back(child.BUTTONS);
+                node.path.SCORE = child.SCORE;
+                next.push_back(std::move(node));
+            } else {
+                recycle(std::move(child.STATE));
+            }
+        }
+        for (Node &node : beam) {
+            recycle(std::move(node.state));
+        }
+        beam = std::move(next);
+    }
+
+    if (beam.empty()) {
+        return SearchPath { {}, -std::numeric_limits<double>::infinity() };
+    }
+    SearchPath best = std::move(beam.front().path);
+    for (Node &node : beam) {
+        recycle(std::move(node.state));
+    }
+    return best;
+}
@@ -0,0 +1,72 @@
+#include <thread>
+#include "link_cable.h"
+
+/*
+ * post - Sends the byte of a transfer we are driving to the peer.
+ * @time: the M-cycle the transfer completes at.
+ * @data: our outgoing byte.
+ */
+void LinkPort::post(uint64_t time, uint8_t data) {
+    while (!m_peer->m_inbox.push(LinkTransfer { time, data })) {
+        if (m_peer->m_arrival.load(std::memory_order_acquire) == NEVER) {
+            return;  // Unplugged, nobody drains the inbox
+        }
+        std::this_thread::yield();
+    }
+}
+
+/*
+ * reply - Answers a transfer the peer is driving.
+ * @time: the M-cycle the transfer completes at.
+ * @data: our outgoing byte.
+ */
+void LinkPort::reply(uint64_t time, uint8_t data) {
+    while (!m_peer->m_replies.push(LinkTransfer { time, data })) {
+        std::this_thread::yield();
+    }
+}
+
+/*
+ * receive - Takes the next transfer the peer started.
+ * @transfer: set to the transfer.
+ *
+ * Return: false if there is none.
+ */
+bool LinkPort::receive(LinkTransfer &transfer) {
+    return m_inbox.pop(transfer);
+}
+
+/*
+ * wait_for_peer - Waits until the peer has run at least to @now, so every transfer it can start
+ *                 that completes within the next LINK_SYNC_CYCLES has been posted.
+ * @now: the current M-cycle.
+ */
+void LinkPort::wait_for_peer(uint64_t now) {
+    while (m_peer->m_arrival.load(std::memory_order_acquire) < now) {
+        std::this_thread::yield();
+    }
+}
+
+/*
+ * await_reply - Completes a transfer we are driving.
+ * @time: the M-cycle the transfer completes at.
+ *
+ * Return: the peer's byte, or 0xFF if the peer was not waiting for a transfer at @time.
+ */
+uint8_t LinkPort::await_reply(uint64_t time) {
+    // Driving a transfer means we answer nothing up to its end, so we are done that far too
+    arrive(time);
+    done(time);
+
+    LinkTransfer transfer;
+    while (true) {
+        bool peer_done = m_peer->m_done.load(std::memory_order_acquire) >= time;
+        if (m_replies.pop(transfer)) {
+            return transfer.data;
+        }
+        if (peer_done) {
+            return 0xFF;
+        }
+        std::this_thread::yield();
+    }
+}
@@ -1,7 +1,493 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <audio_dump.h>
 #include <cpu.h>
 #include <bus.h>
+#include <fork_server.h>
+#include <hash.h>
+#include <movie.h>
+#include <run_ahead.h>
+#include <savestate.h>
+#include <shm_ring.h>
+#include <test_monitor.h>
 
-int main(int argc, char *argv[])
+struct Options {
+    std::string rom;
+    uint64_t    frames = 60;
+    bool        pipelined = false;
+    std::string shm_name;
+    PixelFormat shm_format = PixelFormat::RGBA8888;
+    uint32_t    shm_slots = 4;
+    std::string hash_frames;
+    bool        hash_state = false;
+    std::string hash_states;
+    std::string audio_dump;
+    uint32_t    audio_rate = 48000;
+    bool        test = false;
+    std::string load_state;
+    std::string save_state;
+    bool        fork_server = false;
+    uint64_t    fork_frame = 0;
+    int32_t     fork_pc = -1;
+    bool        fork_pool = false;
+    unsigned    run_ahead = 0;
+    std::string play_movie;
+    std::string record_movie;
+    uint32_t    movie_hash_interval = 60;
+};
+
+/* Exit status of --test runs that end without a verdict, and of runs stopped by the watchdog */
+constexpr int EXIT_NO_VERDICT = 3;
+constexpr int EXIT_STUCK = 4;
+/* Exit status of --play-movie runs whose state stopped matching the movie */
+constexpr int EXIT_DESYNC = 5;
+
+static void usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --frames N          run for N frames (default 60)\n"
+              << "  --pipelined         render on a separate thread\n"
+              << "  --shm NAME          publish frames to the shared-memory ring NAME\n"
+              << "  --shm-format FMT    rgba8888 (default), rgb565 or gray8\n"
+              << "  --shm-slots N       frames kept in the ring (default 4)\n"
+              << "  --hash-frames FILE  write the hash of every completed frame to FILE\n"
+              << "  --hash-state        print the hash of the final machine state\n"
+              << "  --hash-states FILE  write the hash of the whole machine state after every frame\n"
+              << "                      to FILE, to find where two runs diverge\n"
+              << "  --audio-dump FILE   record audio to FILE (WAV if it ends in .wav, else raw PCM)\n"
+              << "  --audio-rate N      audio sample rate (default 48000)\n"
+              << "  --load-state FILE   start from the savestate FILE\n"
+              << "  --save-state FILE   write a savestate to FILE when the run ends\n"
+              << "  --run-ahead N       present the frame N frames ahead of the real one, hiding N\n"
+              << "                      frames of the game's input lag; prints the cost per frame\n"
+              << "  --play-movie FILE   replay the input movie FILE to its end (instead of --frames),\n"
+              << "                      checking its state hashes; exit 5 on a desync\n"
+              << "  --record-movie FILE record the run's input to the movie FILE\n"
+              << "  --movie-hash-interval N\n"
+              << "                      frames between state hashes in recorded movies (default 60)\n"
+              << "  --test              stop at a test ROM verdict and print its serial output;\n"
+              << "                      exit 0 if passed, 1 if failed, 3 without a verdict\n"
+              << "  --fork-server       boot to the fork point, then run one job per line of stdin\n"
+              << "                      (--frames, --test, --hash-state, --hash-states, --save-state,\n"
+              << "                      --play-movie of a movie that starts from a savestate) from there\n"
+              << "  --fork-frame N      fork point: the end of frame N (default: --frames)\n"
+              << "  --fork-pc ADDR      fork point: the first instruction at ADDR (hex)\n"
+              << "  --fork-pool         run jobs on pooled in-process copies instead of fork()\n"
+              << "The fork server runs headless: it takes none of the frame, audio or movie output options.\n"
+              << "Run-ahead needs the inline renderer and cannot be combined with --test or --fork-server.\n"
+              << "Runs that provably hang (e.g. HALT with IE=0) stop early with exit status 4.\n";
+}
+
+/*
+ * parse_number - Parses the whole of @text as an unsigned number.
+ * @text:  the text.
+ * @value: set to the number.
+ * @base:  the base of the number.
+ *
+ * Return: false if @text is not a number in @base or does not fit @value.
+ */
+template <typename T>
+static bool parse_number(const char *text, T &value, int base = 10)
+{
+    const char *end = text + std::strlen(text);
+    std::from_chars_result result = std::from_chars(text, end, value, base);
+    return result.ec == std::errc() && result.ptr == end && result.ptr != text;
+}
+
+static bool parse_args(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--frames" && has_value) {
+            if (!parse_number(argv[++i], options.frames)) {
+                return false;
+            }
+        } else if (arg == "--pipelined") {
+            options.pipelined = true;
+        } else if (arg == "--shm" && has_value) {
+            options.shm_name = argv[++i];
+        } else if (arg == "--shm-format" && has_value) {
+            std::string format = argv[++i];
+            if (format == "rgba8888") {
+                options.shm_format = PixelFormat::RGBA8888;
+            } else if (format == "rgb565") {
+                options.shm_format = PixelFormat::RGB565;
+            } else if (format == "gray8") {
+                options.shm_format = PixelFormat::GRAYSCALE8;
+            } else {
+                return false;
+            }
+        } else if (arg == "--shm-slots" && has_value) {
+            if (!parse_number(argv[++i], options.shm_slots)) {
+                return false;
+            }
+        } else if (arg == "--hash-frames" && has_value) {
+            options.hash_frames = argv[++i];
+        } else if (arg == "--hash-state") {
+            options.hash_state = true;
+        } else if (arg == "--hash-states" && has_value) {
+            options.hash_states = argv[++i];
+        } else if (arg == "--audio-dump" && has_value) {
+            options.audio_dump = argv[++i];
+        } else if (arg == "--audio-rate" && has_value) {
+            if (!parse_number(argv[++i], options.audio_rate)) {
+                return false;
+            }
+        } else if (arg == "--load-state" && has_value) {
+            options.load_state = argv[++i];
+        } else if (arg == "--save-state" && has_value) {
+            options.save_state = argv[++i];
+        } else if (arg == "--test") {
+            options.test = true;
+        } else if (arg == "--run-ahead" && has_value) {
+            if (!parse_number(argv[++i], options.run_ahead)) {
+                return false;
+            }
+        } else if (arg == "--play-movie" && has_value) {
+            options.play_movie = argv[++i];
+        } else if (arg == "--record-movie" && has_value) {
+            options.record_movie = argv[++i];
+        } else if (arg == "--movie-hash-interval" && has_value) {
+            if (!parse_number(argv[++i], options.movie_hash_interval)) {
+                return false;
+            }
+        } else if (arg == "--fork-server") {
+            options.fork_server = true;
+        } else if (arg == "--fork-frame" && has_value) {
+            if (!parse_number(argv[++i], options.fork_frame)) {
+                return false;
+            }
+        } else if (arg == "--fork-pc" && has_value) {
+            uint16_t pc;
+            if (!parse_number(argv[++i], pc, 16)) {
+                return false;
+            }
+            options.fork_pc = pc;
+        } else if (arg == "--fork-pool") {
+            options.fork_pool = true;
+        } else if (arg[0] != '-' && options.rom.empty()) {
+            options.rom = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.rom.empty();
+}
+
+/*
+ * run - Runs the machine for the options' frame count, to the end of the movie played or to a test
+ *       verdict, and reports the result.
+ * @cpu:     the machine.
+ * @options: the run options.
+ *
+ * Return: the exit status.
+ */
+static int run(CPU &cpu, const Options &options)
+{
+    PPU *ppu = cpu.get_bus()->get_ppu();
+
+    TestMonitor monitor;
+    if (options.test) {
+        monitor.attach(cpu);
+    }
+
+    MovieReader movie;
+    if (!options.play_movie.empty() && (!movie.open(options.play_movie) || !movie.prepare(cpu))) {
+        return 1;
+    }
+    MovieWriter recording;
+    if (!options.record_movie.empty()) {
+        const std::string &start_state = movie.is_open() ? movie.get_start_state() : options.load_state;
+        if (!recording.open(options.record_movie, cpu, options.movie_hash_interval, start_state)) {
+            return 1;
+        }
+    }
+
+    std::ofstream state_log;
+    if (!options.hash_states.empty()) {
+        state_log.open(options.hash_states, std::ios::out | std::ios::trunc);
+        if (!state_log) {
+            std::cerr << "Error: Unable to open file " << options.hash_states << std::endl;
+            return 1;
+        }
+    }
+    StateHasher hasher;
+
+    // Frames stop while the LCD is off, so the run is also bounded in cycles. A movie bounds
+    // itself, every frame it holds being bounded by run_to_frame_end()
+    uint64_t frame_limit = movie.is_open() ? UINT64_MAX : ppu->get_state().FRAMES + options.frames;
+    uint64_t cycle_limit = movie.is_open() ? UINT64_MAX : cpu.get_state().MCYCLES + options.frames * PPU_FRAME_CYCLES;
+    bool per_frame = options.run_ahead || movie.is_open() || recording.is_open() || state_log.is_open();
+    RunAhead run_ahead(options.run_ahead);
+    FrameRunner run_frame = [&run_ahead, &options](CPU &cpu) {
+        if (options.run_ahead) {
+            run_ahead.run_frame(cpu);
+        } else {
+            run_to_frame_end(cpu);
+        }
+    };
+    MovieReplay replay;
+    try {
+        while (ppu->get_state().FRAMES < frame_limit && cpu.get_state().MCYCLES < cycle_limit &&
+               monitor.get_result() == TestResult::RUNNING && !cpu.get_stuck_reason()) {
+            if (!per_frame) {
+                cpu.step();
+                continue;
+            }
+            uint8_t buttons = 0;
+            if (movie.is_open()) {
+                if (!play_frame(movie, cpu, replay, run_frame, &buttons)) {
+                    break;
+                }
+            } else {
+                run_frame(cpu);
+                replay.FRAMES++;
+            }
+            if (recording.is_open()) {
+                recording.write_frame(buttons, cpu);
+            }
+            if (state_log.is_open()) {
+                char line[48];
+                int length = std::snprintf(line, sizeof(line), "%llu %016llx\n", (unsigned long long)replay.FRAMES,
+                                           (unsigned long long)hasher.update(*cpu.get_bus()));
+                state_log.write(line, length);
+            }
+            if (replay.DESYNC_FRAME >= 0) {
+                break;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << " at PC=0x" << std::hex << cpu.get_state().PC.r16 << std::endl;
+        ppu->flush();
+        return 1;
+    }
+    ppu->flush();
+
+    if (options.run_ahead) {
+        const RunAheadStats &stats = run_ahead.get_stats();
+        uint64_t frames = std::max<uint64_t>(stats.FRAMES, 1);
+        uint64_t total = stats.EMULATE_NS + stats.AHEAD_NS + stats.SAVE_NS + stats.RESTORE_NS;
+        std::fprintf(stderr, "Run-ahead %u: %llu frames, %.1f us/frame (real %.1f, ahead %.1f, save %.1f, restore %.1f)\n",
+                     options.run_ahead, (unsigned long long)stats.FRAMES, total / 1e3 / frames,
+                     stats.EMULATE_NS / 1e3 / frames, stats.AHEAD_NS / 1e3 / frames,
+                     stats.SAVE_NS / 1e3 / frames, stats.RESTORE_NS / 1e3 / frames);
+    }
+
+    if (recording.is_open() && !recording.close()) {
+        return 1;
+    }
+    if (movie.is_open()) {
+        std::fprintf(stderr, "Movie: %llu frames, %llu state hashes verified\n",
+                     (unsigned long long)replay.FRAMES, (unsigned long long)replay.VERIFIED);
+        if (replay.DESYNC_FRAME >= 0) {
+            std::cerr << "Desync: state differs from the movie after frame " << replay.DESYNC_FRAME << std::endl;
+            return EXIT_DESYNC;
+        }
+        if (movie.is_damaged()) {
+            return 1;
+        }
+    }
+
+    if (!options.save_state.empty() && !save_state(options.save_state, *cpu.get_bus())) {
+        return 1;
+    }
+
+    if (options.hash_state) {
+        std::printf("%016llx\n", (unsigned long long)hash_machine(cpu));
+    }
+    if (options.test) {
+        std::fputs(monitor.get_output().c_str(), stdout);
+    }
+    if (cpu.get_stuck_reason() && monitor.get_result() == TestResult::RUNNING) {
+        std::cerr << "Stuck: " << cpu.get_stuck_reason() << " at PC=0x" << std::hex << cpu.get_state().PC.r16
+                  << std::dec << " after " << cpu.get_state().MCYCLES << " M-cycles" << std::endl;
+        return EXIT_STUCK;
+    }
+    if (options.test) {
+        switch (monitor.get_result()) {
+            case TestResult::PASSED:
+                return 0;
+            case TestResult::FAILED:
+                return 1;
+            default:
+                std::cerr << "No verdict after " << cpu.get_state().MCYCLES << " M-cycles" << std::endl;
+                return EXIT_NO_VERDICT;
+        }
+    }
+
+    return 0;
+}
+
+/* The options a fork server job may set; the server's own options fix the rest */
+static const char *const JOB_OPTIONS[] = {
+    "--frames", "--test", "--hash-state", "--hash-states", "--save-state", "--play-movie",
+};
+
+/*
+ * check_job - Checks that a fork server job only sets options run() applies to the forked machine.
+ * @words: the job's arguments.
+ * @job:   the job options parsed from them.
+ *
+ * Return: false if the job sets another option, or plays a movie that starts from power-on, which
+ *         the machine at the fork point is not.
+ */
+static bool check_job(const std::vector<std::string> &words, const Options &job)
 {
+    for (const std::string &word : words) {
+        if (word.compare(0, 2, "--") == 0 &&
+            std::find(std::begin(JOB_OPTIONS), std::end(JOB_OPTIONS), word) == std::end(JOB_OPTIONS)) {
+            std::cerr << "Error: Jobs cannot set " << word << std::endl;
+            return false;
+        }
+    }
+    if (!job.play_movie.empty()) {
+        MovieReader movie;
+        if (!movie.open(job.play_movie)) {
+            return false;
+        }
+        if (movie.get_start_state().empty()) {
+            std::cerr << "Error: Movie " << job.play_movie << " starts from power-on, not from a savestate" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * serve - Boots to the fork point and runs every job read from stdin from there. Each line holds
+ *         the run options of one job; the server's own options are their defaults.
+ * @cpu:     the machine.
+ * @options: the server options.
+ *
+ * Return: 0 once stdin is exhausted, 1 if the fork point was not reached.
+ */
+static int serve(CPU &cpu, const Options &options)
+{
+    ForkServer server(cpu);
+    ForkPoint point;
+    point.frame = options.fork_frame;
+    point.pc = options.fork_pc;
+    if (point.frame == 0 && point.pc < 0) {
+        point.frame = options.frames;
+    }
+    point.cycle_limit = cpu.get_state().MCYCLES + std::max(point.frame, options.frames) * PPU_FRAME_CYCLES;
+    try {
+        if (!server.boot(point)) {
+            return 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << " at PC=0x" << std::hex << cpu.get_state().PC.r16 << std::endl;
+        return 1;
+    }
+
+    std::string line;
+    for (uint64_t id = 0; std::getline(std::cin, line); id++) {
+        std::istringstream stream(line);
+        std::vector<std::string> words { "job" };
+        for (std::string word; stream >> word;) {
+            words.push_back(word);
+        }
+        std::vector<char *> args;
+        for (std::string &word : words) {
+            args.push_back(word.data());
+        }
+
+        Options job = options;
+        int status;
+        if (!parse_args(args.size(), args.data(), job) || !check_job(words, job)) {
+            std::cerr << "Error: Invalid job: " << line << std::endl;
+            status = 2;
+        } else if (options.fork_pool) {
+            CPU *instance = server.acquire();
+            status = run(*instance, job);
+            server.release(instance);
+        } else {
+            pid_t pid = server.fork_job([&job](CPU &child) { return run(child, job); });
+            status = pid < 0 ? 1 : ForkServer::wait_job(pid);
+        }
+        std::cout << "job " << id << " exit " << status << std::endl;
+    }
     return 0;
 }
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    bool valid = parse_args(argc, argv, options);
+    bool output = options.pipelined || !options.shm_name.empty() || !options.hash_frames.empty() ||
+                  !options.audio_dump.empty() || !options.record_movie.empty();
+    bool run_ahead_conflict = options.run_ahead && (options.pipelined || options.test || options.fork_server);
+    if (!valid || (options.fork_server && output) || run_ahead_conflict) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    ROM *rom = new ROM();
+    rom->load(options.rom);
+    CPU cpu(new Bus(rom));
+    cpu.reset();
+    PPU *ppu = cpu.get_bus()->get_ppu();
+    APU *apu = cpu.get_bus()->get_apu();
+
+    SharedFrameRing ring;
+    if (!options.shm_name.empty() && !ring.create(options.shm_name, options.shm_format, options.shm_slots)) {
+        return 1;
+    }
+    FrameHashLog hash_log;
+    if (!options.hash_frames.empty() && !hash_log.open(options.hash_frames)) {
+        return 1;
+    }
+    if (!options.shm_name.empty() || !options.hash_frames.empty()) {
+        ppu->set_frame_callback([&](const Frame &frame) {
+            if (!options.hash_frames.empty()) {
+                hash_log.on_frame(frame);
+            }
+            if (!options.shm_name.empty()) {
+                ring.publish(frame);
+            }
+        });
+    }
+    ppu->set_pipelined(options.pipelined);
+    // Without a consumer for the pixels (run-ahead presents its own) only the PPU state is kept,
+    // which is all a batch replay needs
+    if (!options.pipelined && options.shm_name.empty() && options.hash_frames.empty() && !options.run_ahead) {
+        ppu->set_rendering(false);
+    }
+
+    // Without a consumer for the samples only the register-visible audio state is kept
+    AudioDump dump;
+    if (!options.audio_dump.empty()) {
+        const std::string &name = options.audio_dump;
+        bool wav = name.size() >= 4 && name.compare(name.size() - 4, 4, ".wav") == 0;
+        if (!dump.open(name, wav ? AudioFileFormat::WAV : AudioFileFormat::RAW, options.audio_rate)) {
+            return 1;
+        }
+        apu->set_sample_rate(options.audio_rate);
+        apu->set_audio_callback([&dump](const int16_t *samples, size_t frames) {
+            dump.write(samples, frames);
+        });
+    } else {
+        apu->set_synthesis(false);
+    }
+
+    if (!options.load_state.empty()) {
+        Savestate state;
+        if (!state.open(options.load_state) || !state.restore(*cpu.get_bus())) {
+            return 1;
+        }
+    }
+
+    int status = options.fork_server ? serve(cpu, options) : run(cpu, options);
+    if (!dump.close() && status == 0) {
+        status = 1;
+    }
+    return status;
+}
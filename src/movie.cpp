@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+#include "hash.h"
+#include "movie.h"
+#include "run_ahead.h"
+#include "savestate.h"
+
+/*
+ * open - Creates (truncates) a movie file and writes its header.
+ * @path:          the file to write.
+ * @cpu:           the machine the movie is recorded on, for the ROM hash.
+ * @hash_interval: frames between embedded state hashes, 0 for none.
+ * @start_state:   the savestate the recording starts from, or empty for power-on.
+ *
+ * Return: false if the file could not be created.
+ */
+bool MovieWriter::open(const std::string &path, CPU &cpu, uint32_t hash_interval, const std::string &start_state) {
+    close();
+
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        std::cerr << "Error: Unable to open file " << path << std::endl;
+        return false;
+    }
+    m_hash_interval = hash_interval;
+    m_frames = 0;
+    m_failed = false;
+    m_buffer.clear();
+    m_buffer.reserve(MOVIE_BUFFER_SIZE);
+
+    MovieHeader header {};
+    std::memcpy(header.MAGIC, MOVIE_MAGIC, sizeof(header.MAGIC));
+    header.VERSION = MOVIE_VERSION;
+    header.HASH_INTERVAL = hash_interval;
+    header.ROM_HASH = hash_rom(cpu);
+    header.FRAME_COUNT = MOVIE_UNKNOWN_LENGTH;
+    header.START_STATE_SIZE = start_state.size();
+    append(&header, sizeof(header));
+    append(start_state.data(), start_state.size());
+    return true;
+}
+
+void MovieWriter::append(const void *data, size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    if (m_buffer.size() >= MOVIE_BUFFER_SIZE) {
+        flush();
+    }
+}
+
+void MovieWriter::flush() {
+    size_t written = 0;
+    while (written < m_buffer.size() && !m_failed) {
+        ssize_t n = write(m_fd, m_buffer.data() + written, m_buffer.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            std::cerr << "Error: Unable to write movie" << std::endl;
+            m_failed = true;
+            break;
+        }
+        written += n;
+    }
+    m_buffer.clear();
+}
+
+/*
+ * write_frame - Records a frame that has just been run.
+ * @buttons: the buttons held during the frame.
+ * @cpu:     the machine, at the end of the frame.
+ */
+void MovieWriter::write_frame(uint8_t buttons, CPU &cpu) {
+    append(&buttons, 1);
+    m_frames++;
+    if (m_hash_interval && m_frames % m_hash_interval == 0) {
+        uint64_t hash = hash_machine(cpu);
+        append(&hash, sizeof(hash));
+    }
+}
+
+/*
+ * close - Writes out the rest of the movie and its length.
+ *
+ * Return: false if any of the movie could not be written.
+ */
+bool MovieWriter::close() {
+    if (m_fd < 0) {
+        return true;
+    }
+    flush();
+    uint64_t frames = m_frames;
+    if (!m_failed && pwrite(m_fd, &frames, sizeof(frames), offsetof(MovieHeader, FRAME_COUNT)) != sizeof(frames)) {
+        std::cerr << "Error: Unable to write movie" << std::endl;
+        m_failed = true;
+    }
+    ::close(m_fd);
+    m_fd = -1;
+    return !m_failed;
+}
+
+/*
+ * open - Opens a movie file and reads its header.
+ * @path: the file to open.
+ *
+ * Return: true if the file is a movie this build can play.
+ */
+bool MovieReader::open(const std::string &path) {
+    close();
+
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        std::cerr << "Error: Unable to open file " << path << std::endl;
+        return false;
+    }
+    posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    m_buffer.resize(MOVIE_BUFFER_SIZE);
+
+    if (!read_bytes(&m_header, sizeof(m_header)) ||
+        std::memcmp(m_header.MAGIC, MOVIE_MAGIC, sizeof(m_header.MAGIC)) != 0) {
+        std::cerr << "Error: " << path << " is not a movie" << std::endl;
+        close();
+        return false;
+    }
+    if (m_header.VERSION != MOVIE_VERSION) {
+        std::cerr << "Error: Movie " << path << " has unsupported version " << m_header.VERSION << std::endl;
+        close();
+        return false;
+    }
+    m_start_state.resize(m_header.START_STATE_SIZE);
+    if (!read_bytes(&m_start_state[0], m_start_state.size())) {
+        std::cerr << "Error: Movie " << path << " is truncated" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MovieReader::close() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_header = MovieHeader {};
+    m_start_state.clear();
+    m_frames = 0;
+    m_damaged = false;
+    m_position = 0;
+    m_end = 0;
+}
+
+bool MovieReader::read_bytes(void *data, size_t size) {
+    uint8_t *bytes = static_cast<uint8_t *>(data);
+    while (size > 0) {
+        if (m_position == m_end) {
+            ssize_t n = read(m_fd, m_buffer.data(), m_buffer.size());
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            m_position = 0;
+            m_end = n;
+        }
+        size_t chunk = std::min(size, m_end - m_position);
+        std::memcpy(bytes, m_buffer.data() + m_position, chunk);
+        m_position += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+/*
+ * prepare - Puts a machine where the movie starts: checks it has the ROM the movie was recorded
+ *           with and restores the start state, if the movie has one.
+ * @cpu: the machine, as it is at power-on if the movie has no start state.
+ *
+ * Return: false if the ROM differs or the start state cannot be restored.
+ */
+bool MovieReader::prepare(CPU &cpu) {
+    if (hash_rom(cpu) != m_header.ROM_HASH) {
+        std::cerr << "Error: Movie was recorded with a different ROM" << std::endl;
+        return false;
+    }
+    if (m_start_state.empty()) {
+        return true;
+    }
+    Savestate state;
+    return state.open(m_start_state) && state.restore(*cpu.get_bus());
+}
+
+/*
+ * read_frame - Takes the input of the next frame.
+ * @buttons: set to the buttons held during the frame.
+ * @check:   set to whether the movie has a hash of the state at the end of the frame.
+ * @hash:    set to that hash, if @check.
+ *
+ * Return: false at the end of the movie, or if it is damaged (see is_damaged()).
+ */
+bool MovieReader::read_frame(uint8_t &buttons, bool &check, uint64_t &hash) {
+    if (m_frames == m_header.FRAME_COUNT || !read_bytes(&buttons, 1)) {
+        if (m_header.FRAME_COUNT != MOVIE_UNKNOWN_LENGTH && m_frames != m_header.FRAME_COUNT) {
+            std::cerr << "Error: Movie ends after " << m_frames << " of " << m_header.FRAME_COUNT << " frames" << std::endl;
+            m_damaged = true;
+        }
+        return false;
+    }
+    m_frames++;
+    check = m_header.HASH_INTERVAL && m_frames % m_header.HASH_INTERVAL == 0;
+    if (check && !read_bytes(&hash, sizeof(hash))) {
+        std::cerr << "Error: Movie is truncated at frame " << m_frames << std::endl;
+        m_damaged = true;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * play_frame - Runs the next frame of a movie and checks the state hash embedded after it, if any.
+ * @movie:     the movie, prepared for @cpu.
+ * @cpu:       the machine.
+ * @result:    counts the frame and the hash checked; DESYNC_FRAME is set if the hash did not match.
+ * @run_frame: runs the frame once the buttons are set, or nullptr for run_to_frame_end().
+ * @buttons:   set to the buttons held during the frame, if not nullptr.
+ *
+ * Return: false if the movie has no more frames (see MovieReader::read_frame()), in which case
+ *         no frame ran.
+ */
+bool play_frame(MovieReader &movie, CPU &cpu, MovieReplay &result, const FrameRunner &run_frame, uint8_t *buttons) {
+    uint8_t held;
+    bool check;
+    uint64_t hash;
+    if (!movie.read_frame(held, check, hash)) {
+        return false;
+    }
+    cpu.get_bus()->set_buttons(held);
+    if (run_frame) {
+        run_frame(cpu);
+    } else {
+        run_to_frame_end(cpu);
+    }
+    result.FRAMES++;
+    if (check) {
+        if (hash_machine(cpu) == hash) {
+            result.VERIFIED++;
+        } else if (result.DESYNC_FRAME < 0) {
+            result.DESYNC_FRAME = result.FRAMES;
+        }
+    }
+    if (buttons) {
+        *buttons = held;
+    }
+    return true;
+}
+
+/*
+ * replay_movie - Plays a movie to its end or its first desync, as fast as the machine runs.
+ * @movie:  the movie, just opened.
+ * @cpu:    the machine, as for MovieReader::prepare(). Configure it headless (no rendering, no
+ *          synthesis) for batch speed; neither affects the state the hashes cover.
+ * @result: set to the outcome.
+ *
+ * Return: true if every frame ran and every embedded hash matched.
+ */
+bool replay_movie(MovieReader &movie, CPU &cpu, MovieReplay &result) {
+    result = MovieReplay {};
+    if (!movie.prepare(cpu)) {
+        return false;
+    }
+    while (play_frame(movie, cpu, result)) {
+        if (result.DESYNC_FRAME >= 0) {
+            return false;
+        }
+    }
+    return !movie.is_damaged();
+}
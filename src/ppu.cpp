@@ -0,0 +1,387 @@
+#include <algorithm>
+#include <cstring>
+#include "ppu.h"
+#include "render_thread.h"
+
+constexpr uint8_t LCDC_BG_ENABLE     = 1 << 0;
+constexpr uint8_t LCDC_OBJ_ENABLE    = 1 << 1;
+constexpr uint8_t LCDC_OBJ_SIZE      = 1 << 2;
+constexpr uint8_t LCDC_BG_MAP        = 1 << 3;
+constexpr uint8_t LCDC_TILE_DATA     = 1 << 4;
+constexpr uint8_t LCDC_WINDOW_ENABLE = 1 << 5;
+constexpr uint8_t LCDC_WINDOW_MAP    = 1 << 6;
+constexpr uint8_t LCDC_LCD_ENABLE    = 1 << 7;
+
+constexpr uint8_t STAT_HBLANK_INT = 1 << 3;
+constexpr uint8_t STAT_VBLANK_INT = 1 << 4;
+constexpr uint8_t STAT_OAM_INT    = 1 << 5;
+constexpr uint8_t STAT_LYC_INT    = 1 << 6;
+constexpr uint8_t STAT_LYC_EQUAL  = 1 << 2;
+
+constexpr uint8_t INT_VBLANK = 1 << 0;
+constexpr uint8_t INT_STAT   = 1 << 1;
+
+/*
+ * tile_row - Fetches the two bit planes of one row of a tile.
+ * @vram: the 8KB of VRAM.
+ * @lcdc: the LCDC value selecting the tile data area.
+ * @tile: the tile index from the tile map.
+ * @row:  the row inside the tile (0-7).
+ *
+ * Return: the low plane in bits 0-7 and the high plane in bits 8-15.
+ */
+static uint16_t tile_row(const uint8_t *vram, uint8_t lcdc, uint8_t tile, uint8_t row)
+{
+    uint16_t offset = (lcdc & LCDC_TILE_DATA)
+        ? tile * 16
+        : 0x1000 + (int8_t)tile * 16;
+    offset += row * 2;
+    return vram[offset] | (vram[offset + 1] << 8);
+}
+
+static uint8_t color_id(uint16_t planes, uint8_t column)
+{
+    uint8_t bit = 7 - column;
+    return ((planes >> bit) & 1) | (((planes >> (8 + bit)) & 1) << 1);
+}
+
+static uint8_t shade(uint8_t palette, uint8_t color)
+{
+    return (palette >> (color * 2)) & 0b11;
+}
+
+/*
+ * window_visible - Whether the window covers part of line @state.LY.
+ * @state: the register state.
+ */
+static bool window_visible(const PPUState &state)
+{
+    return (state.LCDC & LCDC_BG_ENABLE) && (state.LCDC & LCDC_WINDOW_ENABLE) && state.LY >= state.WY &&
+           state.WX - 7 < SCREEN_WIDTH;
+}
+
+static void draw_line(const uint8_t *vram, const uint8_t *oam, PPUState &state, uint8_t *out)
+{
+    uint8_t colors[SCREEN_WIDTH];
+    const uint8_t ly = state.LY;
+
+    if (!(state.LCDC & LCDC_BG_ENABLE)) {
+        std::memset(colors, 0, sizeof(colors));
+    } else {
+        /* Background, one tile row fetch per 8 pixels */
+        uint16_t map = (state.LCDC & LCDC_BG_MAP) ? 0x1C00 : 0x1800;
+        uint8_t y = ly + state.SCY;
+        uint8_t x = state.SCX;
+        uint16_t planes = tile_row(vram, state.LCDC, vram[map + (y / 8) * 32 + x / 8], y % 8);
+        for (int i = 0; i < SCREEN_WIDTH; i++, x++) {
+            if (i > 0 && (x % 8) == 0) {
+                planes = tile_row(vram, state.LCDC, vram[map + (y / 8) * 32 + x / 8], y % 8);
+            }
+            colors[i] = color_id(planes, x % 8);
+        }
+
+        /* Window */
+        int window_x = state.WX - 7;
+        if (window_visible(state)) {
+            uint16_t window_map = (state.LCDC & LCDC_WINDOW_MAP) ? 0x1C00 : 0x1800;
+            uint8_t wy = state.WINDOW_LINE++;
+            for (int i = std::max(window_x, 0); i < SCREEN_WIDTH; i++) {
+                uint8_t wx = i - window_x;
+                if (i == std::max(window_x, 0) || (wx % 8) == 0) {
+                    planes = tile_row(vram, state.LCDC, vram[window_map + (wy / 8) * 32 + wx / 8], wy % 8);
+                }
+                colors[i] = color_id(planes, wx % 8);
+            }
+        }
+    }
+
+    for (int i = 0; i < SCREEN_WIDTH; i++) {
+        out[i] = shade(state.BGP, colors[i]);
+    }
+
+    if (!(state.LCDC & LCDC_OBJ_ENABLE)) {
+        return;
+    }
+
+    /* Sprites: the first 10 in OAM order that overlap the line, drawn by DMG priority */
+    uint8_t height = (state.LCDC & LCDC_OBJ_SIZE) ? 16 : 8;
+    uint8_t selected[10];
+    size_t count = 0;
+    for (uint8_t i = 0; i < 40 && count < 10; i++) {
+        int y = oam[i * 4] - 16;
+        if (ly >= y && ly < y + height) {
+            selected[count++] = i;
+        }
+    }
+    std::stable_sort(selected, selected + count, [oam](uint8_t a, uint8_t b) {
+        return oam[a * 4 + 1] < oam[b * 4 + 1];
+    });
+
+    bool claimed[SCREEN_WIDTH] = {false};
+    for (size_t s = 0; s < count; s++) {
+        const uint8_t *sprite = &oam[selected[s] * 4];
+        int y = sprite[0] - 16;
+        int x = sprite[1] - 8;
+        uint8_t tile = sprite[2];
+        uint8_t attributes = sprite[3];
+
+        uint8_t row = ly - y;
+        if (attributes & 0x40) {  // Y flip
+            row = height - 1 - row;
+        }
+        if (height == 16) {
+            tile &= 0xFE;
+        }
+        uint16_t offset = tile * 16 + row * 2;
+        uint16_t planes = vram[offset] | (vram[offset + 1] << 8);
+        uint8_t palette = (attributes & 0x10) ? state.OBP1 : state.OBP0;
+
+        for (int column = 0; column < 8; column++) {
+            int i = x + column;
+            if (i < 0 || i >= SCREEN_WIDTH || claimed[i]) {
+                continue;
+            }
+            uint8_t color = color_id(planes, (attributes & 0x20) ? 7 - column : column);
+            if (color == 0) {
+                continue;
+            }
+            claimed[i] = true;
+            if (!(attributes & 0x80) || colors[i] == 0) {
+                out[i] = shade(palette, color);
+            }
+        }
+    }
+}
+
+void render_scanline(const uint8_t *vram, const uint8_t *oam, PPUState &state, Frame &frame)
+{
+    const uint8_t ly = state.LY;
+    if (ly == 0) {
+        state.WINDOW_LINE = 0;
+        if (frame.number == 0) {
+            frame.dirty_lines.set();
+        } else {
+            frame.dirty_lines.reset();
+        }
+    }
+
+    uint8_t line[SCREEN_WIDTH];
+    draw_line(vram, oam, state, line);
+    if (std::memcmp(line, frame.pixels[ly], SCREEN_WIDTH) != 0) {
+        std::memcpy(frame.pixels[ly], line, SCREEN_WIDTH);
+        frame.dirty_lines.set(ly);
+    }
+}
+
+void skip_scanline(PPUState &state)
+{
+    if (state.LY == 0) {
+        state.WINDOW_LINE = 0;
+    }
+    if (window_visible(state)) {
+        state.WINDOW_LINE++;
+    }
+}
+
+void store_register(PPUState &state, uint16_t address, uint8_t data)
+{
+    switch (address) {
+        case 0xFF40: state.LCDC = data; break;
+        case 0xFF41: state.STAT = (state.STAT & 0x07) | (data & 0x78); break;
+        case 0xFF42: state.SCY = data; break;
+        case 0xFF43: state.SCX = data; break;
+        case 0xFF45: state.LYC = data; break;
+        case 0xFF47: state.BGP = data; break;
+        case 0xFF48: state.OBP0 = data; break;
+        case 0xFF49: state.OBP1 = data; break;
+        case 0xFF4A: state.WY = data; break;
+        case 0xFF4B: state.WX = data; break;
+        default: break;  // LY is read-only
+    }
+}
+
+PPU::PPU(VRAM *vram, OAM *oam, Scheduler *scheduler)
+    : m_vram(vram), m_oam(oam), m_scheduler(scheduler) {}
+
+PPU::~PPU() = default;
+
+/*
+ * read_register - Reads a PPU register (0xFF40-0xFF4B, except 0xFF46).
+ * @address: the register address.
+ *
+ * Return: the register value.
+ */
+uint8_t PPU::read_register(uint16_t address) {
+    switch (address) {
+        case 0xFF40: return m_state.LCDC;
+        case 0xFF41: return 0x80 | (m_state.STAT & 0x7C) | m_state.MODE;
+        case 0xFF42: return m_state.SCY;
+        case 0xFF43: return m_state.SCX;
+        case 0xFF44: return m_state.LY;
+        case 0xFF45: return m_state.LYC;
+        case 0xFF47: return m_state.BGP;
+        case 0xFF48: return m_state.OBP0;
+        case 0xFF49: return m_state.OBP1;
+        case 0xFF4A: return m_state.WY;
+        case 0xFF4B: return m_state.WX;
+        default: return 0xFF;
+    }
+}
+
+/*
+ * write_register - Writes a PPU register (0xFF40-0xFF4B, except 0xFF46).
+ * @address: the register address.
+ * @data:    the value to write.
+ * @now:     the current M-cycle, used to restart timing when the LCD is switched on.
+ */
+void PPU::write_register(uint16_t address, uint8_t data, uint64_t now) {
+    uint8_t previous_lcdc = m_state.LCDC;
+    store_register(m_state, address, data);
+
+    if (address != 0xFF41 && address != 0xFF44 && address != 0xFF45) {
+        record_write(now, address, data);
+    }
+
+    if (address == 0xFF40 && ((previous_lcdc ^ data) & LCDC_LCD_ENABLE)) {
+        m_state.LY = 0;
+        if (data & LCDC_LCD_ENABLE) {
+            m_state.MODE = PPU_MODE_OAM_SCAN;
+            m_scheduler->schedule(Event::PPU, now + PPU_OAM_SCAN_CYCLES);
+        } else {
+            m_state.MODE = PPU_MODE_HBLANK;
+            m_scheduler->cancel(Event::PPU);
+        }
+    }
+}
+
+/*
+ * on_event - Advances the PPU to its next mode and schedules the one after.
+ * @now:             the M-cycle the event was scheduled for.
+ * @interrupt_flags: the IF register, updated with VBlank/STAT requests.
+ */
+void PPU::on_event(uint64_t now, uint8_t &interrupt_flags) {
+    uint64_t next = 0;
+
+    switch (m_state.MODE) {
+        case PPU_MODE_OAM_SCAN:
+            set_mode(PPU_MODE_TRANSFER, interrupt_flags);
+            if (m_render_thread) {
+                log(PPUWrite { now, m_state.LY, m_state.LY, PPUWrite::LINE });
+                skip_scanline(m_state);
+            } else if (m_rendering) {
+                render_scanline(m_vram->data(), m_oam->data(), m_state, m_frame);
+            } else {
+                skip_scanline(m_state);
+            }
+            next = PPU_TRANSFER_CYCLES;
+            break;
+
+        case PPU_MODE_TRANSFER:
+            set_mode(PPU_MODE_HBLANK, interrupt_flags);
+            next = PPU_HBLANK_CYCLES;
+            break;
+
+        case PPU_MODE_HBLANK:
+            m_state.LY++;
+            if (m_state.LY == SCREEN_HEIGHT) {
+                set_mode(PPU_MODE_VBLANK, interrupt_flags);
+                interrupt_flags |= INT_VBLANK;
+                m_state.FRAMES++;
+                if (m_render_thread) {
+                    log(PPUWrite { now, 0, 0, PPUWrite::FRAME });
+                } else if (m_rendering) {
+                    m_frame.number = m_state.FRAMES;
+                    if (m_frame_callback) {
+                        m_frame_callback(m_frame);
+                    }
+                }
+                next = PPU_LINE_CYCLES;
+            } else {
+                set_mode(PPU_MODE_OAM_SCAN, interrupt_flags);
+                next = PPU_OAM_SCAN_CYCLES;
+            }
+            compare_ly(interrupt_flags);
+            break;
+
+        case PPU_MODE_VBLANK:
+            if (++m_state.LY > 153) {
+                m_state.LY = 0;
+                set_mode(PPU_MODE_OAM_SCAN, interrupt_flags);
+                next = PPU_OAM_SCAN_CYCLES;
+            } else {
+                next = PPU_LINE_CYCLES;
+            }
+            compare_ly(interrupt_flags);
+            break;
+    }
+
+    m_scheduler->schedule(Event::PPU, now + next);
+}
+
+/*
+ * set_pipelined - Moves pixel generation to a render thread, or back onto the CPU thread.
+ * @enabled: true to render on a separate thread.
+ */
+void PPU::set_pipelined(bool enabled) {
+    if (enabled == is_pipelined()) {
+        return;
+    }
+    if (enabled) {
+        m_render_thread = std::make_unique<RenderThread>(m_vram->data(), m_oam->data(), m_state, m_frame_callback);
+    } else {
+        m_render_thread->flush();
+        m_render_thread.reset();
+    }
+}
+
+/*
+ * flush - Waits until the render thread has consumed every logged entry.
+ */
+void PPU::flush() {
+    if (m_render_thread) {
+        m_render_thread->flush();
+    }
+}
+
+/*
+ * resync - Rebuilds the render thread's copies of VRAM, OAM and the registers after the state was
+ *          replaced, e.g. by a snapshot restore. No-op unless pipelined.
+ */
+void PPU::resync() {
+    if (m_render_thread) {
+        m_render_thread->flush();
+        m_render_thread = std::make_unique<RenderThread>(m_vram->data(), m_oam->data(), m_state, m_frame_callback);
+    }
+}
+
+void PPU::set_frame_callback(FrameCallback callback) {
+    if (m_render_thread) {
+        m_render_thread->flush();
+        m_render_thread->set_frame_callback(callback);
+    }
+    m_frame_callback = std::move(callback);
+}
+
+void PPU::log(const PPUWrite &entry) {
+    m_render_thread->push(entry);
+}
+
+void PPU::set_mode(uint8_t mode, uint8_t &interrupt_flags) {
+    m_state.MODE = mode;
+    if ((mode == PPU_MODE_HBLANK   && (m_state.STAT & STAT_HBLANK_INT)) ||
+        (mode == PPU_MODE_VBLANK   && (m_state.STAT & STAT_VBLANK_INT)) ||
+        (mode == PPU_MODE_OAM_SCAN && (m_state.STAT & STAT_OAM_INT))) {
+        interrupt_flags |= INT_STAT;
+    }
+}
+
+void PPU::compare_ly(uint8_t &interrupt_flags) {
+    if (m_state.LY == m_state.LYC) {
+        m_state.STAT |= STAT_LYC_EQUAL;
+        if (m_state.STAT & STAT_LYC_INT) {
+            interrupt_flags |= INT_STAT;
+        }
+    } else {
+        m_state.STAT &= ~STAT_LYC_EQUAL;
+    }
+}
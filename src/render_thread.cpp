@@ -0,0 +1,117 @@
+#include <cstring>
+#include "render_thread.h"
+
+RenderThread::RenderThread(const uint8_t *vram, const uint8_t *oam, const PPUState &state, FrameCallback callback)
+    : m_state(state), m_frame_callback(std::move(callback))
+{
+    std::memcpy(m_vram, vram, sizeof(m_vram));
+    std::memcpy(m_oam, oam, sizeof(m_oam));
+    m_thread = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+    m_running.store(false, std::memory_order_release);
+    wake();
+    m_thread.join();
+}
+
+/*
+ * push - Appends an entry to the log, spinning while the render thread is a full log behind.
+ *        Writes alone do not wake the render thread; they wait for the line that needs them.
+ * @entry: the entry to append.
+ */
+void RenderThread::push(const PPUWrite &entry) {
+    while (!m_log.push(entry)) {
+        wake();
+        std::this_thread::yield();
+    }
+    m_pushed++;
+    if (entry.kind != PPUWrite::WRITE) {
+        wake();
+    }
+}
+
+/*
+ * flush - Waits until every pushed entry has been applied.
+ */
+void RenderThread::flush() {
+    wake();
+    while (m_processed.load(std::memory_order_acquire) != m_pushed) {
+        std::this_thread::yield();
+    }
+}
+
+/*
+ * wake - Wakes the render thread if it is asleep. The fence orders the entries pushed (or the
+ *        stop request) before the check, pairing with the one in sleep().
+ */
+void RenderThread::wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_sleep_lock);
+        m_sleeping.store(false, std::memory_order_relaxed);
+        m_wake.notify_one();
+    }
+}
+
+/*
+ * sleep - Blocks the render thread until wake(), unless an entry or a stop request arrived
+ *         in the meantime.
+ */
+void RenderThread::sleep() {
+    std::unique_lock<std::mutex> lock(m_sleep_lock);
+    m_sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_log.size() != 0 || !m_running.load(std::memory_order_relaxed)) {
+        m_sleeping.store(false, std::memory_order_relaxed);
+        return;
+    }
+    m_wake.wait(lock, [this] { return !m_sleeping.load(std::memory_order_relaxed); });
+}
+
+void RenderThread::run() {
+    PPUWrite entry;
+    int idle = 0;
+    while (true) {
+        if (!m_log.pop(entry)) {
+            if (!m_running.load(std::memory_order_acquire)) {
+                break;
+            }
+            if (++idle < IDLE_SPINS) {
+                std::this_thread::yield();
+            } else {
+                sleep();
+            }
+            continue;
+        }
+        idle = 0;
+        apply(entry);
+        m_processed.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void RenderThread::apply(const PPUWrite &entry) {
+    switch (entry.kind) {
+        case PPUWrite::WRITE:
+            if (entry.address < 0xA000) {
+                m_vram[entry.address & 0x1FFF] = entry.data;
+            } else if (entry.address < 0xFF00) {
+                m_oam[entry.address & 0xFF] = entry.data;
+            } else {
+                store_register(m_state, entry.address, entry.data);
+            }
+            break;
+
+        case PPUWrite::LINE:
+            m_state.LY = entry.data;
+            render_scanline(m_vram, m_oam, m_state, m_frame);
+            break;
+
+        case PPUWrite::FRAME:
+            m_frame.number = ++m_state.FRAMES;
+            if (m_frame_callback) {
+                m_frame_callback(m_frame);
+            }
+            break;
+    }
+}
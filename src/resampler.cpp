@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cmath>
+#include "resampler.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+Resampler::Resampler(double input_rate, double output_rate) {
+    set_rates(input_rate, output_rate);
+    reset();
+}
+
+/*
+ * set_rates - Sets the nominal rates and rebuilds the filter for them.
+ * @input_rate:  the input samples per second.
+ * @output_rate: the output samples per second.
+ */
+void Resampler::set_rates(double input_rate, double output_rate) {
+    m_nominal_ratio = input_rate / output_rate;
+    m_ratio = m_nominal_ratio;
+
+    /* Low-pass below the lower of the two Nyquist rates, leaving room for the transition band */
+    const double cutoff = std::min(1.0, output_rate / input_rate) * 0.91;
+    for (int phase = 0; phase <= PHASES; phase++) {
+        double center = TAPS / 2 - 1 + (double)phase / PHASES;
+        double sum = 0;
+        for (int i = 0; i < TAPS; i++) {
+            double x = i - center;
+            double sinc = (x == 0) ? 1.0 : std::sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+            double u = x / TAPS;
+            double window = 0.42 + 0.5 * std::cos(2 * M_PI * u) + 0.08 * std::cos(4 * M_PI * u);
+            m_kernel[phase][i] = (float)(sinc * window);
+            sum += m_kernel[phase][i];
+        }
+        for (int i = 0; i < TAPS; i++) {
+            m_kernel[phase][i] = (float)(m_kernel[phase][i] / sum);
+        }
+    }
+}
+
+/*
+ * reset - Drops buffered input and starts from silence.
+ */
+void Resampler::reset() {
+    m_left.assign(TAPS - 1, 0.0f);
+    m_right.assign(TAPS - 1, 0.0f);
+    m_position = 0;
+}
+
+static int16_t to_sample(float value) {
+    return (int16_t)std::clamp(std::lround(value), -32768L, 32767L);
+}
+
+/*
+ * process - Converts a block of interleaved stereo samples. Input that cannot be used yet is
+ *           kept for the next call.
+ * @in:         the input samples.
+ * @frames:     the number of input sample pairs.
+ * @out:        the output samples, interleaved.
+ * @max_frames: the room in @out, in sample pairs.
+ *
+ * Return: the number of sample pairs written to @out.
+ */
+size_t Resampler::process(const int16_t *in, size_t frames, int16_t *out, size_t max_frames) {
+    for (size_t i = 0; i < frames; i++) {
+        m_left.push_back(in[i * 2]);
+        m_right.push_back(in[i * 2 + 1]);
+    }
+
+    size_t produced = 0;
+    while (produced < max_frames) {
+        size_t index = (size_t)m_position;
+        if (index + TAPS > m_left.size()) {
+            break;
+        }
+        double phase_position = (m_position - index) * PHASES;
+        int phase = (int)phase_position;
+        float blend = (float)(phase_position - phase);
+        const float *k0 = m_kernel[phase];
+        const float *k1 = m_kernel[phase + 1];
+        const float *left = &m_left[index];
+        const float *right = &m_right[index];
+        float sum_left;
+        float sum_right;
+
+#if defined(__SSE2__)
+        __m128 t = _mm_set1_ps(blend);
+        __m128 acc_left = _mm_setzero_ps();
+        __m128 acc_right = _mm_setzero_ps();
+        for (int i = 0; i < TAPS; i += 4) {
+            __m128 a = _mm_load_ps(k0 + i);
+            __m128 k = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(k1 + i), a), t));
+            acc_left = _mm_add_ps(acc_left, _mm_mul_ps(_mm_loadu_ps(left + i), k));
+            acc_right = _mm_add_ps(acc_right, _mm_mul_ps(_mm_loadu_ps(right + i), k));
+        }
+        /* Horizontal sums: (l0+l2, l1+l3, r0+r2, r1+r3), then pairwise */
+        __m128 low = _mm_movelh_ps(acc_left, acc_right);
+        __m128 high = _mm_movehl_ps(acc_right, acc_left);
+        __m128 pairs = _mm_add_ps(low, high);
+        __m128 swapped = _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 sums = _mm_add_ps(pairs, swapped);
+        sum_left = _mm_cvtss_f32(sums);
+        sum_right = _mm_cvtss_f32(_mm_movehl_ps(sums, sums));
+#else
+        sum_left = 0;
+        sum_right = 0;
+        for (int i = 0; i < TAPS; i++) {
+            float k = k0[i] + (k1[i] - k0[i]) * blend;
+            sum_left += left[i] * k;
+            sum_right += right[i] * k;
+        }
+#endif
+
+        out[produced * 2] = to_sample(sum_left);
+        out[produced * 2 + 1] = to_sample(sum_right);
+        produced++;
+        m_position += m_ratio;
+    }
+
+    /* Keep only the input the next output still needs */
+    size_t consumed = std::min((size_t)m_position, m_left.size());
+    m_left.erase(m_left.begin(), m_left.begin() + consumed);
+    m_right.erase(m_right.begin(), m_right.begin() + consumed);
+    m_position -= consumed;
+    return produced;
+}
@@ -0,0 +1,203 @@
+#include <cstring>
+#include "rewind.h"
+
+static const uint8_t ZEROS[sizeof(Snapshot)] = {};
+
+static void put_varint(std::vector<uint8_t> &out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static size_t get_varint(const uint8_t *&in) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = *in++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+/*
+ * encode_xor - Codes @a XOR @b as runs: (unchanged count, changed count, changed bytes XORed).
+ * @a:    the new bytes.
+ * @b:    the bytes to diff against.
+ * @size: the number of bytes.
+ * @out:  the buffer to append to.
+ */
+static void encode_xor(const uint8_t *a, const uint8_t *b, size_t size, std::vector<uint8_t> &out) {
+    size_t i = 0;
+    while (i < size) {
+        size_t start = i;
+        while (i + 8 <= size && std::memcmp(a + i, b + i, 8) == 0) {
+            i += 8;
+        }
+        while (i < size && a[i] == b[i]) {
+            i++;
+        }
+        size_t unchanged = i - start;
+
+        // A changed run ends at four unchanged bytes, where a new run pays for its two counts
+        start = i;
+        while (i < size && !(i + 4 <= size && std::memcmp(a + i, b + i, 4) == 0)) {
+            i++;
+        }
+        put_varint(out, unchanged);
+        put_varint(out, i - start);
+        for (size_t k = start; k < i; k++) {
+            out.push_back(a[k] ^ b[k]);
+        }
+    }
+}
+
+/*
+ * decode_xor - Applies a run-coded XOR to @target.
+ * @in:     the coded runs.
+ * @length: the size of the coded runs.
+ * @target: the bytes to XOR into.
+ */
+static void decode_xor(const uint8_t *in, size_t length, uint8_t *target) {
+    const uint8_t *end = in + length;
+    while (in < end) {
+        target += get_varint(in);
+        size_t changed = get_varint(in);
+        for (size_t k = 0; k < changed; k++) {
+            target[k] ^= in[k];
+        }
+        in += changed;
+        target += changed;
+    }
+}
+
+/*
+ * Rewind - Creates an empty rewind ring.
+ * @budget:            the bytes of coded entries kept before the oldest are dropped.
+ * @interval:          on_frame() records one snapshot every @interval frames.
+ * @keyframe_interval: entries per keyframe.
+ */
+Rewind::Rewind(size_t budget, unsigned interval, unsigned keyframe_interval)
+    : m_newest(std::make_unique<Snapshot>()), m_current(std::make_unique<Snapshot>()), m_budget(budget),
+      m_interval(interval ? interval : 1), m_keyframe_interval(keyframe_interval ? keyframe_interval : 1) {
+    m_scratch.reserve(sizeof(Snapshot) * 2);
+}
+
+/*
+ * on_frame - Counts a completed frame and records the machine every interval frames.
+ * @bus: the machine.
+ */
+void Rewind::on_frame(Bus &bus) {
+    if (++m_frames < m_interval) {
+        return;
+    }
+    m_frames = 0;
+    bus.update_snapshot(*m_current);
+    push(*m_current);
+}
+
+/*
+ * rewind - Restores the newest recorded state and forgets it.
+ * @bus: the machine.
+ *
+ * Return: false if nothing is recorded.
+ */
+bool Rewind::rewind(Bus &bus) {
+    if (!pop(*m_current)) {
+        return false;
+    }
+    bus.load_snapshot(*m_current);
+    m_frames = 0;
+    return true;
+}
+
+/*
+ * push - Records a state as the newest entry.
+ * @snapshot: the state.
+ */
+void Rewind::push(const Snapshot &snapshot) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&snapshot);
+    bool keyframe = m_entries.empty() || m_since_keyframe + 1 >= m_keyframe_interval;
+
+    m_scratch.clear();
+    encode_xor(bytes, keyframe ? ZEROS : reinterpret_cast<const uint8_t *>(m_newest.get()), sizeof(Snapshot),
+               m_scratch);
+    m_entries.push_back(Entry { std::vector<uint8_t>(m_scratch.begin(), m_scratch.end()), keyframe });
+    m_used += m_scratch.size();
+    m_since_keyframe = keyframe ? 0 : m_since_keyframe + 1;
+
+    std::memcpy(m_newest.get(), &snapshot, sizeof(Snapshot));
+    evict();
+}
+
+/*
+ * pop - Takes the newest state off the ring.
+ * @snapshot: set to the state.
+ *
+ * Return: false if the ring is empty.
+ */
+bool Rewind::pop(Snapshot &snapshot) {
+    if (m_entries.empty()) {
+        return false;
+    }
+    std::memcpy(&snapshot, m_newest.get(), sizeof(Snapshot));
+
+    Entry entry = std::move(m_entries.back());
+    m_entries.pop_back();
+    m_used -= entry.data.size();
+    if (m_entries.empty()) {
+        return true;
+    }
+    if (!entry.keyframe) {
+        decode_xor(entry.data.data(), entry.data.size(), reinterpret_cast<uint8_t *>(m_newest.get()));
+        m_since_keyframe--;
+    } else {
+        decode_newest();
+    }
+    return true;
+}
+
+void Rewind::clear() {
+    m_entries.clear();
+    m_used = 0;
+    m_frames = 0;
+    m_since_keyframe = 0;
+}
+
+/*
+ * decode_newest - Rebuilds the newest state from the last keyframe and the deltas after it.
+ */
+void Rewind::decode_newest() {
+    size_t keyframe = m_entries.size() - 1;
+    while (!m_entries[keyframe].keyframe) {
+        keyframe--;
+    }
+    uint8_t *target = reinterpret_cast<uint8_t *>(m_newest.get());
+    std::memset(target, 0, sizeof(Snapshot));
+    for (size_t i = keyframe; i < m_entries.size(); i++) {
+        decode_xor(m_entries[i].data.data(), m_entries[i].data.size(), target);
+    }
+    m_since_keyframe = m_entries.size() - 1 - keyframe;
+}
+
+/*
+ * evict - Drops the oldest keyframes and their deltas until the budget is met, keeping at least
+ *         the newest keyframe.
+ */
+void Rewind::evict() {
+    while (m_used > m_budget) {
+        size_t next = 1;
+        while (next < m_entries.size() && !m_entries[next].keyframe) {
+            next++;
+        }
+        if (next == m_entries.size()) {
+            return;
+        }
+        for (size_t i = 0; i < next; i++) {
+            m_used -= m_entries.front().data.size();
+            m_entries.pop_front();
+        }
+    }
+}
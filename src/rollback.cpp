@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+#include "rollback.h"
+#include "run_ahead.h"
+
+FdTransport::FdTransport(int read_fd, int write_fd) : m_read_fd(read_fd), m_write_fd(write_fd) {
+    fcntl(m_read_fd, F_SETFL, fcntl(m_read_fd, F_GETFL) | O_NONBLOCK);
+}
+
+bool FdTransport::send(const InputPacket &packet) {
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(&packet);
+    size_t sent = 0;
+    while (sent < sizeof(packet)) {
+        ssize_t n = write(m_write_fd, data + sent, sizeof(packet) - sent);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        // A socket shared with the non-blocking reads does not block writes either
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd writable = { m_write_fd, POLLOUT, 0 };
+            ::poll(&writable, 1, -1);
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+bool FdTransport::receive(InputPacket &packet) {
+    while (m_partial_size < sizeof(packet)) {
+        ssize_t n = read(m_read_fd, m_partial + m_partial_size, sizeof(packet) - m_partial_size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        // The end of the stream, or a socket reset by a peer that closed with data unread
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            m_closed = true;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        m_partial_size += n;
+    }
+    std::memcpy(&packet, m_partial, sizeof(packet));
+    m_partial_size = 0;
+    return true;
+}
+
+/*
+ * RollbackSession - Starts a session at the machine's current state, which must be the same on
+ *                   both sides.
+ * @cpu:          the machine. Needs the inline renderer.
+ * @transport:    the connection to the other side.
+ * @local_player: 0 or 1, the other side being the other one.
+ * @max_rollback: how many frames the session may run ahead of the remote input.
+ */
+RollbackSession::RollbackSession(CPU &cpu, RollbackTransport &transport, int local_player, unsigned max_rollback)
+    : m_cpu(cpu), m_transport(transport), m_local_player(local_player), m_max_rollback(max_rollback),
+      m_local(2 * (max_rollback + 1)), m_remote(2 * (max_rollback + 1)), m_predicted(2 * (max_rollback + 1)),
+      m_snapshots(max_rollback + 1) {}
+
+uint8_t RollbackSession::remote_input(uint32_t frame) const {
+    if (frame < m_remote_frames) {
+        return m_remote[frame % m_remote.size()];
+    }
+    return m_remote_frames ? m_remote[(m_remote_frames - 1) % m_remote.size()] : 0;
+}
+
+/*
+ * run - Snapshots the machine and emulates one frame with the inputs known or predicted for it.
+ * @frame: the frame number.
+ *
+ * Return: false if the machine is stuck, noted in m_stuck_frame.
+ */
+bool RollbackSession::run(uint32_t frame) {
+    Bus *bus = m_cpu.get_bus();
+    bus->save_snapshot(m_snapshots[frame % m_snapshots.size()]);
+
+    uint8_t local = m_local[frame % m_local.size()];
+    uint8_t remote = remote_input(frame);
+    m_predicted[frame % m_predicted.size()] = remote;
+    bus->set_buttons(m_local_player == 0 ? m_combine(local, remote) : m_combine(remote, local));
+    if (!run_to_frame_end(m_cpu)) {
+        m_stuck_frame = std::min(m_stuck_frame, frame);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * rollback - Returns to the earliest mispredicted frame and emulates up to the present again,
+ *            without playing the frames already shown. Only the last of them is drawn, so the
+ *            screen shows the corrected present.
+ */
+void RollbackSession::rollback() {
+    uint32_t first = m_rollback_to;
+    m_rollback_to = UINT32_MAX;
+    if (first >= m_frame) {
+        return;
+    }
+    Bus *bus = m_cpu.get_bus();
+    PPU *ppu = bus->get_ppu();
+    APU *apu = bus->get_apu();
+
+    bool rendering = ppu->is_rendering();
+    apu->suspend();
+    ppu->set_rendering(false);
+    // The snapshot brings back the stuck verdict of its own state
+    bus->load_snapshot(m_snapshots[first % m_snapshots.size()]);
+    if (m_stuck_frame >= first) {
+        m_stuck_frame = UINT32_MAX;
+    }
+
+    try {
+        for (uint32_t frame = first; frame < m_frame; frame++) {
+            if (frame + 1 == m_frame) {
+                ppu->set_rendering(rendering);
+            }
+            run(frame);
+        }
+    } catch (...) {
+        ppu->set_rendering(rendering);
+        apu->resume();
+        throw;
+    }
+    apu->resume();
+
+    m_stats.ROLLBACKS++;
+    m_stats.RESIMULATED += m_frame - first;
+    m_stats.MAX_DEPTH = std::max(m_stats.MAX_DEPTH, m_frame - first);
+}
+
+/*
+ * poll - Takes every remote input that arrived and corrects the present if any was mispredicted.
+ *        Marks the session stuck if the machine hung in a frame whose inputs are now confirmed.
+ */
+void RollbackSession::poll() {
+    InputPacket packet;
+    while (m_transport.receive(packet)) {
+        if (packet.FRAME != m_remote_frames) {
+            std::cerr << "Error: Rollback input for frame " << packet.FRAME << " arrived out of order" << std::endl;
+            m_connected = false;
+            continue;
+        }
+        m_remote[packet.FRAME % m_remote.size()] = packet.BUTTONS;
+        m_remote_frames++;
+        if (packet.FRAME < m_frame && m_predicted[packet.FRAME % m_predicted.size()] != packet.BUTTONS) {
+            m_rollback_to = std::min(m_rollback_to, packet.FRAME);
+        }
+    }
+    if (m_connected && m_transport.is_closed()) {
+        std::cerr << "Error: Rollback peer disconnected at frame " << m_frame << std::endl;
+        m_connected = false;
+    }
+    rollback();
+    if (!m_stuck && m_stuck_frame < m_remote_frames) {
+        const char *reason = m_cpu.get_stuck_reason();
+        std::cerr << "Error: Rollback machine stuck at frame " << m_stuck_frame << ": "
+                  << (reason ? reason : "unknown") << std::endl;
+        m_stuck = true;
+    }
+}
+
+/*
+ * advance - Sends the local input for the next frame and runs it.
+ * @buttons: the local player's buttons, a mask of Button.
+ *
+ * Return: false if the frame could not run yet because the session is max_rollback frames ahead
+ *         of the remote input, or because the other side is gone or the session is stuck.
+ *         Retry with the same input.
+ */
+bool RollbackSession::advance(uint8_t buttons) {
+    poll();
+    if (!m_connected || m_stuck || m_frame >= m_remote_frames + m_max_rollback) {
+        return false;
+    }
+
+    InputPacket packet = { m_frame, buttons, {} };
+    if (!m_transport.send(packet)) {
+        std::cerr << "Error: Rollback peer disconnected at frame " << m_frame << std::endl;
+        m_connected = false;
+        return false;
+    }
+    m_local[m_frame % m_local.size()] = buttons;
+    run(m_frame);
+    m_frame++;
+    return true;
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include "run_ahead.h"
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point &since) {
+    auto now = std::chrono::steady_clock::now();
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - since).count();
+    since = now;
+    return ns;
+}
+
+bool run_to_frame_end(CPU &cpu) {
+    const PPUState &ppu = cpu.get_bus()->get_ppu()->get_state();
+    const CPUState &state = cpu.get_state();
+    uint64_t frames = ppu.FRAMES;
+    uint64_t cycle_limit = state.MCYCLES + PPU_FRAME_CYCLES;
+    while (ppu.FRAMES == frames && state.MCYCLES < cycle_limit) {
+        if (cpu.get_stuck_reason()) {
+            return false;
+        }
+        cpu.step();
+    }
+    return !cpu.get_stuck_reason();
+}
+
+/*
+ * run_frame - Emulates one real frame and presents the frame get_frames() frames ahead of it.
+ * @cpu: the machine, with the input for this frame already set.
+ */
+void RunAhead::run_frame(CPU &cpu) {
+    Bus *bus = cpu.get_bus();
+    PPU *ppu = bus->get_ppu();
+    APU *apu = bus->get_apu();
+    auto clock = std::chrono::steady_clock::now();
+
+    if (m_frames == 0 || ppu->is_pipelined()) {
+        run_to_frame_end(cpu);
+        m_stats.EMULATE_NS += elapsed_ns(clock);
+        m_stats.FRAMES++;
+        return;
+    }
+
+    ppu->set_rendering(false);
+    bool running;
+    try {
+        running = run_to_frame_end(cpu);
+    } catch (...) {
+        ppu->set_rendering(true);
+        throw;
+    }
+    m_stats.EMULATE_NS += elapsed_ns(clock);
+    if (!running) {
+        ppu->set_rendering(true);
+        m_stats.FRAMES++;
+        return;
+    }
+
+    bus->update_snapshot(*m_snapshot);
+    m_stats.SAVE_NS += elapsed_ns(clock);
+
+    apu->suspend();
+    try {
+        for (unsigned i = 0; i < m_frames && running; i++) {
+            ppu->set_rendering(i + 1 == m_frames);
+            running = run_to_frame_end(cpu);
+        }
+    } catch (...) {
+        ppu->set_rendering(true);
+        bus->revert_snapshot(*m_snapshot);
+        apu->resume();
+        throw;
+    }
+    ppu->set_rendering(true);
+    m_stats.AHEAD_NS += elapsed_ns(clock);
+
+    // A hang in a frame that is thrown away does not end the real run: the revert brings back
+    // the verdict of the real state along with the rest of it
+    bus->revert_snapshot(*m_snapshot);
+    apu->resume();
+    m_stats.RESTORE_NS += elapsed_ns(clock);
+    m_stats.FRAMES++;
+}
@@ -0,0 +1,153 @@
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "savestate.h"
+
+static uint64_t align_page(uint64_t offset) {
+    return (offset + SAVESTATE_PAGE_SIZE - 1) / SAVESTATE_PAGE_SIZE * SAVESTATE_PAGE_SIZE;
+}
+
+/*
+ * save_state - Writes the machine state to a savestate file. The file is written under a
+ *              temporary name and renamed into place, so readers never see half of it.
+ * @path: the file to write.
+ * @bus:  the machine.
+ *
+ * Return: true on success.
+ */
+bool save_state(const std::string &path, Bus &bus) {
+    constexpr size_t count = static_cast<size_t>(Section::COUNT);
+
+    std::unique_ptr<uint8_t[]> first_page(new uint8_t[SAVESTATE_PAGE_SIZE]());
+    SavestateHeader *header = reinterpret_cast<SavestateHeader *>(first_page.get());
+    SavestateSection *table = reinterpret_cast<SavestateSection *>(header + 1);
+    std::memcpy(header->MAGIC, SAVESTATE_MAGIC, sizeof(header->MAGIC));
+    header->VERSION = SAVESTATE_VERSION;
+    header->SECTION_COUNT = count;
+    header->MCYCLES = static_cast<const CPUState *>(bus.get_section(Section::CPU))->MCYCLES;
+
+    uint64_t offset = SAVESTATE_PAGE_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        table[i] = SavestateSection { SNAPSHOT_SECTIONS[i].id, SNAPSHOT_SECTIONS[i].version, offset,
+                                      SNAPSHOT_SECTIONS[i].size };
+        offset = align_page(offset + SNAPSHOT_SECTIONS[i].size);
+    }
+    header->FILE_SIZE = offset;
+
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Error: Unable to open file " << temporary << std::endl;
+        return false;
+    }
+    static const char padding[SAVESTATE_PAGE_SIZE] = {};
+    file.write(reinterpret_cast<const char *>(first_page.get()), SAVESTATE_PAGE_SIZE);
+    for (size_t i = 0; i < count; i++) {
+        size_t size = SNAPSHOT_SECTIONS[i].size;
+        file.write(static_cast<const char *>(bus.get_section(static_cast<Section>(i))), size);
+        file.write(padding, align_page(size) - size);
+    }
+    file.close();
+    if (!file || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Unable to write savestate " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/*
+ * open - Maps a savestate file and checks its header and section table.
+ * @path: the file to open.
+ *
+ * Return: true if the file is a savestate this build can restore.
+ */
+bool Savestate::open(const std::string &path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Unable to open file " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(SAVESTATE_PAGE_SIZE)) {
+        std::cerr << "Error: " << path << " is not a savestate" << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Error: Unable to map file " << path << std::endl;
+        return false;
+    }
+    m_data = static_cast<const uint8_t *>(data);
+    m_size = info.st_size;
+
+    const SavestateHeader *header = get_header();
+    if (std::memcmp(header->MAGIC, SAVESTATE_MAGIC, sizeof(header->MAGIC)) != 0 ||
+        header->VERSION != SAVESTATE_VERSION || header->SECTION_COUNT > SAVESTATE_MAX_SECTIONS ||
+        header->FILE_SIZE != m_size) {
+        std::cerr << "Error: " << path << " is not a version " << SAVESTATE_VERSION << " savestate" << std::endl;
+        close();
+        return false;
+    }
+
+    const SavestateSection *table = reinterpret_cast<const SavestateSection *>(header + 1);
+    for (uint32_t i = 0; i < header->SECTION_COUNT; i++) {
+        const SavestateSection &section = table[i];
+        if (section.OFFSET % SAVESTATE_PAGE_SIZE != 0 || section.OFFSET > m_size ||
+            section.SIZE > m_size - section.OFFSET) {
+            std::cerr << "Error: " << path << " has a damaged section table" << std::endl;
+            close();
+            return false;
+        }
+        for (size_t s = 0; s < static_cast<size_t>(Section::COUNT); s++) {
+            if (SNAPSHOT_SECTIONS[s].id == section.ID) {
+                m_sections[s] = &section;
+            }
+        }
+    }
+    return true;
+}
+
+void Savestate::close() {
+    if (m_data) {
+        munmap(const_cast<uint8_t *>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    for (const SavestateSection *&section : m_sections) {
+        section = nullptr;
+    }
+}
+
+/*
+ * restore - Replaces the machine state with the mapped one. Sections missing from the file are
+ *           reset to their defaults.
+ * @bus: the machine.
+ *
+ * Return: false if no file is open.
+ */
+bool Savestate::restore(Bus &bus) const {
+    if (!m_data) {
+        return false;
+    }
+    for (size_t s = 0; s < static_cast<size_t>(Section::COUNT); s++) {
+        const SavestateSection *section = m_sections[s];
+        if (section) {
+            bus.restore_section(static_cast<Section>(s), m_data + section->OFFSET, section->SIZE);
+        } else {
+            bus.restore_section(static_cast<Section>(s), nullptr, 0);
+        }
+    }
+    bus.finish_restore();
+    return true;
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include "serial.h"
+
+/*
+ * read_register - Reads SB or SC.
+ * @address: the register address.
+ *
+ * Return: the register value with unused bits set.
+ */
+uint8_t Serial::read_register(uint16_t address) {
+    if (address == 0xFF01) {
+        return m_state.SB;
+    }
+    return 0x7E | m_state.SC;
+}
+
+/*
+ * write_register - Writes SB or SC. Setting SC bit 7 starts a transfer.
+ * @address: the register address.
+ * @data:    the value to write.
+ * @now:     the current M-cycle.
+ */
+void Serial::write_register(uint16_t address, uint8_t data, uint64_t now) {
+    if (address == 0xFF01) {
+        m_state.SB = data;
+        return;
+    }
+
+    m_state.SC = data & 0x81;
+    if ((m_state.SC & 0x81) == 0x81) {
+        m_state.TRANSFER_END = now + SERIAL_TRANSFER_CYCLES;
+        m_scheduler->schedule(Event::SERIAL, m_state.TRANSFER_END);
+        if (m_output_callback) {
+            m_output_callback(m_state.SB);
+        }
+        if (m_link) {
+            m_link->post(m_state.TRANSFER_END, m_state.SB);
+        }
+    } else {
+        m_state.TRANSFER_END = NEVER;
+        m_scheduler->cancel(Event::SERIAL);
+        if (armed() && m_link) {
+            // Sync right away: the peer may already have started a transfer
+            m_scheduler->schedule(Event::LINK, now);
+        }
+    }
+}
+
+void Serial::complete(uint8_t data, uint8_t &interrupt_flags) {
+    m_state.SB = data;
+    m_state.SC &= 0x7F;
+    interrupt_flags |= 0x08;
+}
+
+/*
+ * on_event - Completes a transfer on the internal clock.
+ * @now:             the M-cycle the transfer ends at.
+ * @interrupt_flags: the IF register, bit 3 is set.
+ */
+void Serial::on_event(uint64_t now, uint8_t &interrupt_flags) {
+    m_state.TRANSFER_END = NEVER;
+    complete(m_link ? m_link->await_reply(now) : 0xFF, interrupt_flags);
+}
+
+/*
+ * on_link - Syncs with the peer: answers the transfers it drives that end now and schedules the
+ *           next sync.
+ * @now:             the current M-cycle.
+ * @interrupt_flags: the IF register, bit 3 is set when a transfer completes here.
+ */
+void Serial::on_link(uint64_t now, uint8_t &interrupt_flags) {
+    m_link->arrive(now);
+    if (armed()) {
+        m_link->wait_for_peer(now);
+    }
+
+    LinkTransfer transfer;
+    while (m_link->receive(transfer)) {
+        m_pending.push_back(transfer);
+    }
+    uint64_t next = (now / LINK_SYNC_CYCLES + 1) * LINK_SYNC_CYCLES;
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (it->time > now) {
+            next = std::min(next, it->time);
+            ++it;
+            continue;
+        }
+        // Transfers that ended while we were not armed never reached us
+        if (it->time == now && armed()) {
+            m_link->reply(now, m_state.SB);
+            complete(it->data, interrupt_flags);
+        }
+        it = m_pending.erase(it);
+    }
+
+    m_link->done(now);
+    m_scheduler->schedule(Event::LINK, next);
+}
+
+/*
+ * set_link - Plugs the port into one end of a link cable, or unplugs it. An instance that stops
+ *            running must unplug, or an armed peer would wait for it forever.
+ * @port: the cable end, or nullptr.
+ * @now:  the current M-cycle.
+ */
+void Serial::set_link(LinkPort *port, uint64_t now) {
+    if (m_link) {
+        m_link->arrive(NEVER);
+        m_link->done(NEVER);
+    }
+    m_link = port;
+    m_pending.clear();
+    if (port) {
+        port->arrive(now);
+        port->done(now);
+        m_scheduler->schedule(Event::LINK, now);
+    } else {
+        m_scheduler->cancel(Event::LINK);
+    }
+}
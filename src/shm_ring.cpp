@@ -0,0 +1,222 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "shm_ring.h"
+
+static size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+SharedFrameRing::~SharedFrameRing() {
+    close();
+}
+
+/*
+ * create - Creates (or replaces) the shared-memory object and initializes an empty ring.
+ * @name:           the POSIX shared-memory name, e.g. "/gbemu".
+ * @format:         the pixel format frames are published in.
+ * @slot_count:     the number of frames kept in the ring.
+ * @audio_capacity: the stereo frames of audio each slot can carry, 0 for video only.
+ *
+ * Return: false if @slot_count is 0 or the shared memory could not be created or mapped.
+ */
+bool SharedFrameRing::create(const std::string &name, PixelFormat format, uint32_t slot_count, uint32_t audio_capacity) {
+    close();
+    if (slot_count == 0) {
+        std::cerr << "Error: Shared memory ring " << name << " needs at least one slot" << std::endl;
+        return false;
+    }
+
+    size_t pixel_bytes = SCREEN_WIDTH * SCREEN_HEIGHT * bytes_per_pixel(format);
+    size_t slot_bytes = align_up(sizeof(ShmSlotHeader) + pixel_bytes + audio_capacity * 2 * sizeof(int16_t), 64);
+    size_t size = align_up(sizeof(ShmRingHeader), 64) + slot_count * slot_bytes;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Error: Unable to create shared memory " << name << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, size) != 0) {
+        std::cerr << "Error: Unable to size shared memory " << name << std::endl;
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Error: Unable to map shared memory " << name << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    m_name = name;
+    m_size = size;
+    m_header = static_cast<ShmRingHeader *>(memory);
+    m_header->slot_count = slot_count;
+    m_header->slot_bytes = slot_bytes;
+    m_header->width = SCREEN_WIDTH;
+    m_header->height = SCREEN_HEIGHT;
+    m_header->format = static_cast<uint32_t>(format);
+    m_header->audio_capacity = audio_capacity;
+    m_header->published.store(0, std::memory_order_relaxed);
+    m_header->version = SHM_RING_VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = SHM_RING_MAGIC;
+
+    m_converter = FrameConverter(format);
+    m_dirty_history.assign(slot_count, std::bitset<SCREEN_HEIGHT>());
+    m_last_frame = 0;
+    m_contiguous = 0;
+    return true;
+}
+
+/*
+ * close - Unmaps and unlinks the ring. Readers that still have it mapped keep their view.
+ */
+void SharedFrameRing::close() {
+    if (m_header) {
+        munmap(m_header, m_size);
+        shm_unlink(m_name.c_str());
+        m_header = nullptr;
+    }
+}
+
+/*
+ * publish - Converts a frame into the next slot and makes it the newest frame.
+ * @frame:        the completed frame.
+ * @audio:        interleaved stereo samples to store with the frame, or nullptr.
+ * @audio_frames: the number of stereo frames in @audio, clamped to the slot's capacity.
+ */
+void SharedFrameRing::publish(const Frame &frame, const int16_t *audio, uint32_t audio_frames) {
+    if (!m_header) {
+        return;
+    }
+
+    uint64_t n = m_header->published.load(std::memory_order_relaxed) + 1;
+    uint8_t *base = slot(n);
+    ShmSlotHeader *slot_header = reinterpret_cast<ShmSlotHeader *>(base);
+    uint8_t *pixels = base + sizeof(ShmSlotHeader);
+
+    slot_header->sequence.store(2 * n - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    /* The slot still holds frame n - slot_count; redo the lines any later frame changed */
+    m_dirty_history[n % m_header->slot_count] = frame.dirty_lines;
+    m_contiguous = (frame.number == m_last_frame + 1) ? m_contiguous + 1 : 0;
+    bool contiguous = n > m_header->slot_count && m_contiguous >= m_header->slot_count;
+    std::bitset<SCREEN_HEIGHT> stale;
+    for (const std::bitset<SCREEN_HEIGHT> &lines : m_dirty_history) {
+        stale |= lines;
+    }
+    m_converter.convert(frame, pixels, SCREEN_WIDTH * bytes_per_pixel(m_converter.get_format()),
+                        contiguous ? &stale : nullptr);
+    m_last_frame = frame.number;
+
+    slot_header->frame_number = frame.number;
+    for (int word = 0; word < 3; word++) {
+        slot_header->dirty_lines[word] = 0;
+    }
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        if (frame.dirty_lines.test(y)) {
+            slot_header->dirty_lines[y / 64] |= 1ULL << (y % 64);
+        }
+    }
+    slot_header->audio_frames = 0;
+    if (audio && m_header->audio_capacity) {
+        uint32_t count = std::min(audio_frames, m_header->audio_capacity);
+        std::memcpy(pixels + SCREEN_WIDTH * SCREEN_HEIGHT * bytes_per_pixel(m_converter.get_format()),
+                    audio, count * 2 * sizeof(int16_t));
+        slot_header->audio_frames = count;
+    }
+
+    slot_header->sequence.store(2 * n, std::memory_order_release);
+    m_header->published.store(n, std::memory_order_release);
+}
+
+uint8_t *SharedFrameRing::slot(uint64_t index) const {
+    uint8_t *slots = reinterpret_cast<uint8_t *>(m_header) + align_up(sizeof(ShmRingHeader), 64);
+    return slots + ((index - 1) % m_header->slot_count) * m_header->slot_bytes;
+}
+
+SharedFrameReader::~SharedFrameReader() {
+    close();
+}
+
+/*
+ * open - Maps an existing ring read-only.
+ * @name: the POSIX shared-memory name the ring was created with.
+ *
+ * Return: false if the ring does not exist or has an unknown layout.
+ */
+bool SharedFrameReader::open(const std::string &name) {
+    close();
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    off_t size = lseek(fd, 0, SEEK_END);
+    void *memory = (size > 0) ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+
+    m_header = static_cast<ShmRingHeader *>(memory);
+    m_size = size;
+    if (m_header->magic != SHM_RING_MAGIC || m_header->version != SHM_RING_VERSION) {
+        std::cerr << "Error: " << name << " is not a compatible frame ring." << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SharedFrameReader::close() {
+    if (m_header) {
+        munmap(m_header, m_size);
+        m_header = nullptr;
+    }
+}
+
+/*
+ * begin_read - Starts an in-place read of frame @sequence.
+ * @sequence:    the frame to read, usually latest().
+ * @slot_header: optionally set to the slot header (frame number, audio frame count).
+ *
+ * Return: the pixels, followed by the audio block; nullptr if the frame was already overwritten.
+ */
+const uint8_t *SharedFrameReader::begin_read(uint64_t sequence, const ShmSlotHeader **slot_header) const {
+    if (sequence == 0) {
+        return nullptr;
+    }
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(m_header) + align_up(sizeof(ShmRingHeader), 64)
+        + ((sequence - 1) % m_header->slot_count) * m_header->slot_bytes;
+    const ShmSlotHeader *header = reinterpret_cast<const ShmSlotHeader *>(base);
+    if (header->sequence.load(std::memory_order_acquire) != 2 * sequence) {
+        return nullptr;
+    }
+    if (slot_header) {
+        *slot_header = header;
+    }
+    return base + sizeof(ShmSlotHeader);
+}
+
+/*
+ * end_read - Checks that frame @sequence was not overwritten during the read.
+ * @sequence: the frame passed to begin_read().
+ *
+ * Return: true if everything read since begin_read() is consistent.
+ */
+bool SharedFrameReader::end_read(uint64_t sequence) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint8_t *base = reinterpret_cast<const uint8_t *>(m_header) + align_up(sizeof(ShmRingHeader), 64)
+        + ((sequence - 1) % m_header->slot_count) * m_header->slot_bytes;
+    const ShmSlotHeader *header = reinterpret_cast<const ShmSlotHeader *>(base);
+    return header->sequence.load(std::memory_order_relaxed) == 2 * sequence;
+}
@@ -0,0 +1,43 @@
+#include "test_monitor.h"
+
+/*
+ * attach - Installs the serial capture and the LD B,B hook on a CPU.
+ * @cpu: the CPU running the test ROM.
+ */
+void TestMonitor::attach(CPU &cpu) {
+    cpu.get_bus()->get_serial()->set_output_callback([this](uint8_t data) { on_serial(data); });
+    cpu.set_breakpoint_hook([this](CPUState &state) { on_breakpoint(state); });
+}
+
+void TestMonitor::on_serial(uint8_t data) {
+    m_output.push_back((char)data);
+    if (m_result != TestResult::RUNNING) {
+        return;
+    }
+    // Only the tail can complete a keyword
+    size_t from = m_output.size() >= 6 ? m_output.size() - 6 : 0;
+    if (m_output.find("Passed", from) != std::string::npos) {
+        m_result = TestResult::PASSED;
+    } else if (m_output.find("Failed", from) != std::string::npos) {
+        m_result = TestResult::FAILED;
+    }
+}
+
+void TestMonitor::on_breakpoint(const CPUState &state) {
+    const uint8_t registers[6] = {
+        state.BC.r8.hi, state.BC.r8.lo, state.DE.r8.hi, state.DE.r8.lo, state.HL.r8.hi, state.HL.r8.lo,
+    };
+    static const uint8_t FIBONACCI[6] = { 3, 5, 8, 13, 21, 34 };
+
+    bool pass = true;
+    bool fail = true;
+    for (int i = 0; i < 6; i++) {
+        pass &= registers[i] == FIBONACCI[i];
+        fail &= registers[i] == 0x42;
+    }
+    if (pass) {
+        m_result = TestResult::PASSED;
+    } else if (fail) {
+        m_result = TestResult::FAILED;
+    }
+}
@@ -0,0 +1,133 @@
+#include "timer.h"
+
+/* T-cycles between two TIMA increments for each TAC clock select */
+static const uint64_t PERIODS[4] = { 1024, 16, 64, 256 };
+
+uint64_t Timer::period() const {
+    return PERIODS[m_state.TAC & 3];
+}
+
+/*
+ * signal - The input of TIMA's falling-edge detector: the selected counter bit ANDed with the
+ *          enable bit.
+ * @now: the current M-cycle.
+ */
+bool Timer::signal(uint64_t now) const {
+    return (m_state.TAC & 0x04) && (counter(now) & (period() / 2));
+}
+
+/*
+ * sync - Adds the falling edges since the last sync to TIMA.
+ * @now: the current M-cycle.
+ */
+void Timer::sync(uint64_t now) {
+    if (m_state.TAC & 0x04) {
+        uint64_t p = period();
+        m_state.TIMA += counter(now) / p - counter(m_state.SYNC_TIME) / p;
+    }
+    m_state.SYNC_TIME = now;
+}
+
+/*
+ * increment - Applies one glitch increment of TIMA, which may overflow it. Requires a sync first.
+ */
+void Timer::increment() {
+    if (m_state.TIMA < 0x100) {
+        m_state.TIMA++;
+    }
+}
+
+/*
+ * reschedule - Schedules the reload that follows the next overflow, if TIMA is counting or an
+ *              overflow is already waiting. Requires a sync first.
+ */
+void Timer::reschedule() {
+    if (m_state.TIMA > 0xFF) {
+        // The overflow happened at SYNC_TIME; the reload lands one M-cycle later
+        m_scheduler->schedule(Event::TIMER, m_state.SYNC_TIME + 1);
+    } else if (m_state.TAC & 0x04) {
+        uint64_t p = period();
+        uint64_t edge = counter(m_state.SYNC_TIME) / p + (0x100 - m_state.TIMA);
+        m_scheduler->schedule(Event::TIMER, m_state.DIV_BASE + edge * p / 4 + 1);
+    } else {
+        m_scheduler->cancel(Event::TIMER);
+    }
+}
+
+/*
+ * read_register - Reads a timer register (0xFF04-0xFF07).
+ * @address: the register address.
+ * @now:     the current M-cycle.
+ *
+ * Return: the register value with unused bits set.
+ */
+uint8_t Timer::read_register(uint16_t address, uint64_t now) {
+    switch (address) {
+        case 0xFF04:
+            return (counter(now) >> 8) & 0xFF;
+        case 0xFF05:
+            sync(now);
+            return m_state.TIMA & 0xFF;
+        case 0xFF06:
+            return m_state.TMA;
+        default:
+            return 0xF8 | m_state.TAC;
+    }
+}
+
+/*
+ * write_register - Writes a timer register (0xFF04-0xFF07).
+ * @address: the register address.
+ * @data:    the value to write.
+ * @now:     the current M-cycle.
+ */
+void Timer::write_register(uint16_t address, uint8_t data, uint64_t now) {
+    sync(now);
+    switch (address) {
+        case 0xFF04: {
+            // Resetting the counter drops a set bit to 0: one extra increment
+            bool before = signal(now);
+            m_state.DIV_BASE = now;
+            if (before) {
+                increment();
+            }
+            break;
+        }
+        case 0xFF05:
+            // Writes in the reload cycle lose to TMA; writes in the overflow cycle cancel it
+            if (now != m_state.RELOAD_TIME) {
+                m_state.TIMA = data;
+            }
+            break;
+        case 0xFF06:
+            m_state.TMA = data;
+            if (now == m_state.RELOAD_TIME) {
+                m_state.TIMA = data;
+            }
+            break;
+        default: {
+            bool before = signal(now);
+            m_state.TAC = data & 0x07;
+            if (before && !signal(now)) {
+                increment();
+            }
+            break;
+        }
+    }
+    reschedule();
+}
+
+/*
+ * on_event - Reloads TIMA from TMA one M-cycle after an overflow and requests the interrupt.
+ * @now:             the M-cycle the reload was scheduled for.
+ * @interrupt_flags: the IF register, bit 2 is set.
+ */
+void Timer::on_event(uint64_t now, uint8_t &interrupt_flags) {
+    sync(now);
+    if (m_state.TIMA > 0xFF) {
+        m_state.TIMA = m_state.TMA;
+        m_state.RELOAD_TIME = now;
+        interrupt_flags |= 0x04;
+    }
+    reschedule();
+}
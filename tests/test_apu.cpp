@@ -0,0 +1,114 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include "cpu.h"
+
+/* Runs the machine clock forward without executing instructions. */
+static void advance(CPU &cpu, uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; i++) {
+        cpu.get_state().MCYCLES++;
+        cpu.get_bus()->tick();
+    }
+}
+
+/* Powers the APU on and routes square channel 1 to both sides at full volume. */
+static void start_square(Bus *bus, uint8_t length_control) {
+    bus->write_n8(0xFF26, 0x80);
+    bus->write_n8(0xFF24, 0x77);
+    bus->write_n8(0xFF25, 0xFF);
+    bus->write_n8(0xFF11, 0x80 | 0x3C);  // 50% duty, length 4
+    bus->write_n8(0xFF12, 0xF0);         // Volume 15, no envelope
+    bus->write_n8(0xFF13, 0x00);
+    bus->write_n8(0xFF14, 0x87 | length_control);
+}
+
+TEST_CASE("APU register reads and channel status", "[apu]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+
+    REQUIRE(bus->read_n8(0xFF26) == 0x70);
+    bus->write_n8(0xFF12, 0xF0);  // Ignored while powered off
+    REQUIRE(bus->read_n8(0xFF12) == 0x00);
+
+    start_square(bus, 0x00);
+    REQUIRE(bus->read_n8(0xFF26) == 0xF1);
+    REQUIRE(bus->read_n8(0xFF11) == 0xBF);
+    REQUIRE(bus->read_n8(0xFF12) == 0xF0);
+
+    bus->write_n8(0xFF12, 0x00);  // DAC off disables the channel
+    REQUIRE(bus->read_n8(0xFF26) == 0xF0);
+
+    bus->write_n8(0xFF30, 0x5A);  // Wave RAM keeps its contents
+    bus->write_n8(0xFF26, 0x00);
+    REQUIRE(bus->read_n8(0xFF26) == 0x70);
+    REQUIRE(bus->read_n8(0xFF30) == 0x5A);
+}
+
+TEST_CASE("APU length counter expires from the frame sequencer", "[apu]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+
+    start_square(bus, 0x40);
+    REQUIRE((bus->read_n8(0xFF26) & 0x01) == 0x01);
+
+    // Length 4 is clocked at 256 Hz: gone after four length steps
+    advance(cpu, APU_SEQUENCER_CYCLES * 9);
+    REQUIRE((bus->read_n8(0xFF26) & 0x01) == 0x00);
+}
+
+TEST_CASE("APU delivers band-limited samples at the output rate", "[apu]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    std::vector<int16_t> samples;
+    bus->get_apu()->set_audio_callback([&samples](const int16_t *data, size_t frames) {
+        samples.insert(samples.end(), data, data + frames * 2);
+    });
+
+    start_square(bus, 0x00);
+    advance(cpu, (uint64_t)GB_CLOCK_RATE / 16);
+
+    // A quarter second at 48 kHz, delivered in 64 Hz blocks
+    size_t frames = samples.size() / 2;
+    REQUIRE(frames >= 12000 - 750);
+    REQUIRE(frames <= 12000);
+
+    int peak = 0;
+    for (size_t i = 0; i < frames; i++) {
+        REQUIRE(samples[i * 2] == samples[i * 2 + 1]);
+        peak = std::max(peak, std::abs((int)samples[i * 2]));
+    }
+    REQUIRE(peak > 1000);
+}
+
+TEST_CASE("APU without synthesis keeps frame sequencer state", "[apu]") {
+    CPU with_audio;
+    CPU without_audio;
+    size_t delivered = 0;
+    without_audio.get_bus()->get_apu()->set_synthesis(false);
+    without_audio.get_bus()->get_apu()->set_audio_callback([&delivered](const int16_t *, size_t frames) {
+        delivered += frames;
+    });
+
+    for (CPU *cpu : { &with_audio, &without_audio }) {
+        Bus *bus = cpu->get_bus();
+        start_square(bus, 0x40);
+        bus->write_n8(0xFF17, 0xF1);  // Channel 2: decreasing envelope
+        bus->write_n8(0xFF19, 0x80);
+        bus->write_n8(0xFF10, 0x11);  // Channel 1: sweep up
+        bus->write_n8(0xFF14, 0x87);
+        advance(*cpu, APU_SEQUENCER_CYCLES * 40);
+    }
+
+    APUState &a = with_audio.get_bus()->get_apu()->get_state();
+    APUState &b = without_audio.get_bus()->get_apu()->get_state();
+    REQUIRE(delivered == 0);
+    REQUIRE(with_audio.get_bus()->read_n8(0xFF26) == without_audio.get_bus()->read_n8(0xFF26));
+    REQUIRE(a.SWEEP_SHADOW == b.SWEEP_SHADOW);
+    for (int c = 0; c < 4; c++) {
+        REQUIRE(a.CH[c].ENABLED == b.CH[c].ENABLED);
+        REQUIRE(a.CH[c].VOLUME == b.CH[c].VOLUME);
+        REQUIRE(a.CH[c].LENGTH == b.CH[c].LENGTH);
+    }
+    REQUIRE(b.CH[1].VOLUME < 15);
+}
@@ -0,0 +1,192 @@
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+#include "audio_dump.h"
+#include "audio_output.h"
+
+/* One second of a stereo sine, the right channel inverted. */
+static std::vector<int16_t> sine(double frequency, double rate, double amplitude) {
+    std::vector<int16_t> samples;
+    for (int i = 0; i < (int)rate; i++) {
+        int16_t value = (int16_t)std::lround(amplitude * std::sin(2 * M_PI * frequency * i / rate));
+        samples.push_back(value);
+        samples.push_back(-value);
+    }
+    return samples;
+}
+
+TEST_CASE("Resampler keeps pitch and level across rates", "[audio]") {
+    Resampler resampler(48000, 44100);
+    std::vector<int16_t> in = sine(1000, 48000, 10000);
+    std::vector<int16_t> out(50000 * 2);
+
+    /* Feed it in uneven blocks, as the APU would */
+    size_t produced = 0;
+    for (size_t pos = 0; pos < in.size() / 2; pos += 797) {
+        size_t frames = std::min((size_t)797, in.size() / 2 - pos);
+        produced += resampler.process(&in[pos * 2], frames, &out[produced * 2], 50000 - produced);
+    }
+    REQUIRE(produced > 44100 - Resampler::TAPS);
+    REQUIRE(produced <= 44101);
+
+    /* Skip the filter's start-up, then check level, channels and zero crossings */
+    int peak = 0;
+    int crossings = 0;
+    for (size_t i = 1000; i < 45000 && i < produced; i++) {
+        peak = std::max(peak, std::abs((int)out[i * 2]));
+        REQUIRE(std::abs(out[i * 2] + out[i * 2 + 1]) <= 1);
+        if ((out[i * 2 - 2] < 0) != (out[i * 2] < 0)) {
+            crossings++;
+        }
+    }
+    double seconds = (std::min(produced, (size_t)45000) - 1000) / 44100.0;
+    REQUIRE(peak > 9700);
+    REQUIRE(peak < 10300);
+    REQUIRE(std::abs(crossings - 2000 * seconds) < 4);
+}
+
+TEST_CASE("AudioOutput drops on overflow and pads underruns", "[audio]") {
+    AudioOutput output(48000, 48000);
+    std::vector<int16_t> block(4096 * 2, 1000);
+
+    for (int i = 0; i < 8; i++) {
+        output.write(block.data(), 4096);
+    }
+    REQUIRE(output.fill_level() == AudioOutput::capacity());
+    REQUIRE(output.get_dropped() > 0);
+
+    std::vector<int16_t> out(AudioOutput::capacity() * 2 + 200);
+    size_t got = output.read(out.data(), out.size() / 2);
+    REQUIRE(got == AudioOutput::capacity());
+    REQUIRE(output.get_underruns() == 100);
+    REQUIRE(out[got * 2 - 1] == 1000);
+    REQUIRE(out[got * 2] == 0);
+    REQUIRE(output.fill_level() == 0);
+}
+
+TEST_CASE("AudioOutput sink thread runs alongside the producer", "[audio]") {
+    AudioOutput output(48000, 44100);
+    std::vector<int16_t> block(750 * 2, 1000);
+    size_t received = 0;
+    size_t wrong = 0;
+    std::atomic<bool> done {false};
+
+    std::thread sink([&]() {
+        std::vector<int16_t> out(512 * 2);
+        while (received < 200000) {
+            size_t got = output.read(out.data(), 512);
+            for (size_t i = 0; i < got; i++) {
+                /* Past the filter's start-up every sample is the input level */
+                if (received + i >= Resampler::TAPS && std::abs(out[i * 2] - 1000) > 2) {
+                    wrong++;
+                }
+            }
+            received += got;
+            if (got == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+    });
+    while (!done) {
+        if (output.fill_level() < AudioOutput::capacity() / 2) {
+            output.write(block.data(), 750);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    sink.join();
+    REQUIRE(wrong == 0);
+    REQUIRE(output.get_dropped() == 0);
+}
+
+/* Runs a producer at the emulated rate against a sink whose clock is off by @drift. */
+static size_t run_drift(AudioOutput &output, double drift, size_t &underruns) {
+    std::vector<int16_t> block(800 * 2, 1000);
+    std::vector<int16_t> out(2000 * 2);
+    double owed = 0;
+
+    while (output.fill_level() < output.get_target_fill()) {
+        output.write(block.data(), 800);
+    }
+    size_t start = output.get_underruns();
+    for (int i = 0; i < 6000; i++) {
+        output.write(block.data(), 800);
+        owed += 800 * 44100.0 / 48000.0 * drift;
+        size_t frames = (size_t)owed;
+        owed -= frames;
+        output.read(out.data(), frames);
+    }
+    underruns = output.get_underruns() - start;
+    return output.fill_level();
+}
+
+TEST_CASE("AudioOutput rate control holds the fill level", "[audio]") {
+    for (double drift : { 1.001, 0.999 }) {
+        AudioOutput output(48000, 44100);
+        size_t underruns;
+        size_t fill = run_drift(output, drift, underruns);
+        REQUIRE(std::abs((double)fill - output.get_target_fill()) > output.get_target_fill() / 2);
+
+        AudioOutput controlled(48000, 44100);
+        controlled.set_rate_control(true);
+        fill = run_drift(controlled, drift, underruns);
+        REQUIRE(underruns == 0);
+        REQUIRE(controlled.get_dropped() == 0);
+        REQUIRE(fill > controlled.get_target_fill() / 2);
+        REQUIRE(fill < controlled.get_target_fill() * 3 / 2);
+        REQUIRE(std::abs(controlled.get_resampler().get_ratio() / (48000.0 / 44100.0) - 1) < 0.005);
+    }
+}
+
+TEST_CASE("AudioDump writes WAV and raw PCM through its writer thread", "[audio]") {
+    std::string base = "/tmp/gb_test_dump_" + std::to_string(getpid());
+    std::vector<int16_t> samples;
+    for (int i = 0; i < 100000; i++) {
+        samples.push_back((int16_t)(i * 7));
+        samples.push_back((int16_t)(-i * 3));
+    }
+
+    for (AudioFileFormat format : { AudioFileFormat::WAV, AudioFileFormat::RAW }) {
+        std::string name = base + (format == AudioFileFormat::WAV ? ".wav" : ".raw");
+        AudioDump dump;
+        REQUIRE(dump.open(name, format, 44100));
+        for (size_t pos = 0; pos < 100000; pos += 1000) {
+            dump.write(&samples[pos * 2], 1000);
+        }
+        REQUIRE(dump.close());
+
+        std::ifstream file(name, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        size_t header = (format == AudioFileFormat::WAV) ? 44 : 0;
+        REQUIRE(bytes.size() == header + samples.size() * 2);
+        if (format == AudioFileFormat::WAV) {
+            uint32_t rate;
+            uint32_t data_size;
+            std::memcpy(&rate, &bytes[24], 4);
+            std::memcpy(&data_size, &bytes[40], 4);
+            REQUIRE(std::string(&bytes[0], 4) == "RIFF");
+            REQUIRE(std::string(&bytes[36], 4) == "data");
+            REQUIRE(rate == 44100);
+            REQUIRE(data_size == samples.size() * 2);
+        }
+        REQUIRE(std::memcmp(&bytes[header], samples.data(), samples.size() * 2) == 0);
+        std::remove(name.c_str());
+    }
+
+    // A full disk must not pass for a complete dump
+    AudioDump full;
+    REQUIRE(full.open("/dev/full", AudioFileFormat::WAV, 44100));
+    for (size_t pos = 0; pos < 100000; pos += 1000) {
+        full.write(&samples[pos * 2], 1000);
+    }
+    REQUIRE_FALSE(full.close());
+}
@@ -0,0 +1,147 @@
+#include <catch2/catch_test_macros.hpp>
+#include "cpu.h"
+
+/* Runs the machine clock forward without executing instructions. */
+static void advance(CPU &cpu, uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; i++) {
+        cpu.get_state().MCYCLES++;
+        cpu.get_bus()->tick();
+    }
+}
+
+TEST_CASE("OAM DMA copies a page and blocks the bus for its window", "[dma]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    for (int i = 0; i < 0xA0; i++) {
+        bus->write_n8(0xC100 + i, i ^ 0x5A);
+    }
+    bus->write_n8(0xFF80, 0x12);
+
+    bus->write_n8(0xFF46, 0xC1);
+    REQUIRE(bus->read_n8(0xFF46) == 0xC1);
+    for (int i = 0; i < 0xA0; i++) {
+        REQUIRE(bus->get_oam()->data()[i] == (i ^ 0x5A));
+    }
+
+    // Only HRAM and IO are reachable until the last byte would have arrived
+    advance(cpu, 1);
+    REQUIRE(bus->read_n8(0xC100) == 0xFF);
+    REQUIRE(bus->read_n8(0xFE00) == 0xFF);
+    bus->write_n8(0xC100, 0x99);
+    REQUIRE(bus->read_n8(0xFF80) == 0x12);
+    advance(cpu, OAM_DMA_CYCLES - 1);
+    REQUIRE(bus->read_n8(0xC100) == 0xFF);
+    advance(cpu, 1);
+    REQUIRE(bus->read_n8(0xC100) == 0x5A);
+    REQUIRE(bus->read_n8(0xFE01) == (1 ^ 0x5A));
+}
+
+TEST_CASE("OAM DMA reads the cartridge and the WRAM mirror", "[dma]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    uint8_t rom[0x200] = {};
+    rom[0x100] = 0x31;
+    rom[0x19F] = 0x32;
+    bus->get_cartridge()->load(rom, sizeof(rom));
+    bus->write_n8(0xC000, 0x41);
+
+    bus->write_n8(0xFF46, 0x01);
+    REQUIRE(bus->get_oam()->data()[0] == 0x31);
+    REQUIRE(bus->get_oam()->data()[0x9F] == 0x32);
+
+    advance(cpu, OAM_DMA_CYCLES + 1);
+    bus->write_n8(0xFF46, 0xE0);
+    REQUIRE(bus->get_oam()->data()[0] == 0x41);
+}
+
+TEST_CASE("VRAM DMA is only available in CGB mode", "[dma]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    bus->write_n8(0xC000, 0x77);
+    bus->write_n8(0xFF51, 0xC0);
+    bus->write_n8(0xFF52, 0x00);
+    bus->write_n8(0xFF55, 0x00);
+    REQUIRE(bus->read_n8(0xFF55) == 0xFF);
+    REQUIRE(bus->get_vram()->data()[0] == 0x00);
+    REQUIRE(cpu.get_state().STALL == 0);
+}
+
+TEST_CASE("General purpose DMA copies everything at once and stalls the CPU", "[dma]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    bus->get_dma()->set_cgb_mode(true);
+    for (int i = 0; i < 0x300; i++) {
+        bus->write_n8(0xC0F0 + i, i & 0xFF);
+    }
+
+    // 0x300 bytes from C0F0 to 9FF0 cross two source pages and wrap around the end of VRAM
+    bus->write_n8(0xFF51, 0xC0);
+    bus->write_n8(0xFF52, 0xF5);    // Low nibble ignored
+    bus->write_n8(0xFF53, 0x1F);
+    bus->write_n8(0xFF54, 0xF0);
+    bus->write_n8(0xFF55, 0x2F);
+
+    uint8_t *vram = bus->get_vram()->data();
+    REQUIRE(vram[0x1FF0] == 0x00);
+    REQUIRE(vram[0x1FFF] == 0x0F);
+    REQUIRE(vram[0x0000] == 0x10);
+    REQUIRE(vram[0x02EF] == 0xFF);
+    REQUIRE(bus->read_n8(0xFF55) == 0xFF);
+    REQUIRE(cpu.get_state().STALL == 0x30 * HDMA_BLOCK_CYCLES);
+
+    // The stall is added to the cycles of the instruction that started the copy
+    cpu.get_state().STALL = 0;
+    uint8_t program[] = { 0xE0, 0x55 };     // LDH (0x55), A
+    bus->get_cartridge()->load(program, sizeof(program));
+    bus->write_n8(0xFF51, 0xC0);
+    bus->write_n8(0xFF52, 0x00);
+    cpu.get_state().AF.r8.hi = 0x01;
+    cpu.step();
+    REQUIRE(cpu.get_state().PC.r16 == 2);
+    REQUIRE(cpu.get_state().STALL == 0);
+    for (uint64_t i = 0; i < 2 * HDMA_BLOCK_CYCLES; i++) {
+        cpu.step();
+    }
+    REQUIRE(cpu.get_state().PC.r16 == 2);
+    while (cpu.get_state().PC.r16 == 2 && cpu.get_state().MCYCLES < 32) {
+        cpu.step();
+    }
+    REQUIRE(cpu.get_state().PC.r16 == 3);
+}
+
+TEST_CASE("HBlank DMA copies one block per HBlank and can be stopped", "[dma]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    bus->get_dma()->set_cgb_mode(true);
+    for (int i = 0; i < 0x40; i++) {
+        bus->write_n8(0xD000 + i, 0x80 + i);
+    }
+
+    bus->write_n8(0xFF40, 0x80);
+    bus->write_n8(0xFF51, 0xD0);
+    bus->write_n8(0xFF52, 0x00);
+    bus->write_n8(0xFF53, 0x00);
+    bus->write_n8(0xFF54, 0x40);
+    bus->write_n8(0xFF55, 0x83);    // 4 blocks, started in mode 2
+    REQUIRE(bus->read_n8(0xFF55) == 0x03);
+    uint8_t *vram = bus->get_vram()->data();
+    REQUIRE(vram[0x40] == 0x00);
+
+    advance(cpu, PPU_OAM_SCAN_CYCLES + PPU_TRANSFER_CYCLES - 1);
+    REQUIRE(vram[0x40] == 0x00);
+    advance(cpu, 1);
+    REQUIRE(vram[0x40] == 0x80);
+    REQUIRE(vram[0x4F] == 0x8F);
+    REQUIRE(vram[0x50] == 0x00);
+    REQUIRE(bus->read_n8(0xFF55) == 0x02);
+    REQUIRE(cpu.get_state().STALL == HDMA_BLOCK_CYCLES);
+
+    advance(cpu, PPU_LINE_CYCLES);
+    REQUIRE(vram[0x5F] == 0x9F);
+    REQUIRE(bus->read_n8(0xFF55) == 0x01);
+
+    bus->write_n8(0xFF55, 0x00);
+    REQUIRE(bus->read_n8(0xFF55) == 0x81);
+    advance(cpu, PPU_LINE_CYCLES);
+    REQUIRE(vram[0x60] == 0x00);
+}
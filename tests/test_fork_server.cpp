@@ -0,0 +1,113 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "fork_server.h"
+#include "test_programs.h"
+
+TEST_CASE("The fork server boots to a frame or a PC", "[fork_server]") {
+    CPU cpu;
+    boot_counter(cpu);
+    fill_ram(cpu);
+    ForkServer server(cpu);
+
+    SECTION("frame") {
+        REQUIRE(server.boot(ForkPoint { 2, -1 }));
+        REQUIRE(cpu.get_bus()->get_ppu()->get_state().FRAMES == 2);
+        REQUIRE(server.get_snapshot().PPU.FRAMES == 2);
+    }
+    SECTION("PC") {
+        REQUIRE(server.boot(ForkPoint { 0, 0x0005 }));
+        REQUIRE(cpu.get_state().PC.r16 == 0x0005);
+        REQUIRE(cpu.get_state().WAIT == 0);
+        REQUIRE(server.get_snapshot().CPU.PC.r16 == 0x0005);
+    }
+    SECTION("unreachable") {
+        REQUIRE_FALSE(server.boot(ForkPoint { 0, 0x4000, 10000 }));
+        REQUIRE(cpu.get_state().MCYCLES == 10000);
+    }
+}
+
+TEST_CASE("Pooled instances start at the fork point", "[fork_server]") {
+    CPU cpu;
+    boot_counter(cpu);
+    fill_ram(cpu);
+    ForkServer server(cpu);
+    REQUIRE(server.boot(ForkPoint { 1, -1 }));
+    auto expected = std::make_unique<Snapshot>();
+    cpu.get_bus()->save_snapshot(*expected);
+
+    CPU *first = server.acquire();
+    REQUIRE_FALSE(first->get_bus()->get_ppu()->is_rendering());
+    REQUIRE_FALSE(first->get_bus()->get_apu()->is_synthesis_enabled());
+    REQUIRE(first != &cpu);
+    auto actual = std::make_unique<Snapshot>();
+    first->get_bus()->save_snapshot(*actual);
+    REQUIRE(std::memcmp(actual.get(), expected.get(), sizeof(Snapshot)) == 0);
+
+    // A job's changes do not leak into the next one, nor into the booted machine
+    run(*first, 20000);
+    first->get_bus()->write_n8(0xC123, 0x5A);
+    server.release(first);
+    CPU *second = server.acquire();
+    REQUIRE(second == first);
+    second->get_bus()->save_snapshot(*actual);
+    REQUIRE(std::memcmp(actual.get(), expected.get(), sizeof(Snapshot)) == 0);
+
+    // Instances in use at the same time are distinct, and all run the same program
+    CPU *third = server.acquire();
+    REQUIRE(third != second);
+    run(*second, 5000);
+    run(*third, 5000);
+    REQUIRE(std::memcmp(&second->get_state(), &third->get_state(), sizeof(CPUState)) == 0);
+    REQUIRE(second->get_bus()->read_n8(0xFF80) == third->get_bus()->read_n8(0xFF80));
+    server.release(second);
+    server.release(third);
+
+    cpu.get_bus()->save_snapshot(*actual);
+    REQUIRE(std::memcmp(actual.get(), expected.get(), sizeof(Snapshot)) == 0);
+}
+
+TEST_CASE("Forked jobs run on a copy of the booted machine", "[fork_server]") {
+    CPU cpu;
+    boot_counter(cpu);
+    fill_ram(cpu);
+    ForkServer server(cpu);
+    REQUIRE(server.boot(ForkPoint { 1, -1 }));
+    uint64_t mcycles = cpu.get_state().MCYCLES;
+
+    pid_t pid = server.fork_job([mcycles](CPU &child) {
+        if (child.get_state().MCYCLES != mcycles) {
+            return 1;
+        }
+        run(child, 1000);
+        child.get_bus()->write_n8(0xC000, 0xAA);
+        return 42;
+    });
+    REQUIRE(pid > 0);
+    REQUIRE(ForkServer::wait_job(pid) == 42);
+    REQUIRE(cpu.get_state().MCYCLES == mcycles);
+    REQUIRE(cpu.get_bus()->read_n8(0xC000) == 0x00);
+}
+
+TEST_CASE("A malformed job line fails only that job", "[fork_server]") {
+    std::string rom_path = temp_path("gameboy_test_jobs.gb");
+    std::string jobs_path = temp_path("gameboy_test_jobs.txt");
+    write_file(rom_path, std::vector<uint8_t>(std::begin(COUNTER_PROGRAM), std::end(COUNTER_PROGRAM)));
+    std::ofstream(jobs_path) << "--frames 1\n--frames abc\n--fork-pc 10000\n--frames 1\n";
+
+    std::string command = std::string(GAMEBOY_BINARY) + " " + rom_path +
+                          " --fork-server --fork-pc 4 --frames 1 < " + jobs_path + " 2>/dev/null";
+    FILE *server = popen(command.c_str(), "r");
+    REQUIRE(server != nullptr);
+    std::string output;
+    char buffer[256];
+    while (std::fgets(buffer, sizeof(buffer), server)) {
+        output += buffer;
+    }
+    REQUIRE(pclose(server) == 0);
+    REQUIRE(output == "job 0 exit 0\njob 1 exit 2\njob 2 exit 2\njob 3 exit 0\n");
+    std::filesystem::remove(rom_path);
+    std::filesystem::remove(jobs_path);
+}
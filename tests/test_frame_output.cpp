@@ -0,0 +1,120 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include "frame_output.h"
+#include "hash.h"
+#include "shm_ring.h"
+
+TEST_CASE("FrameConverter output formats") {
+    const uint32_t palette[4] = { 0xE0F8D0, 0x88C070, 0x346856, 0x081820 };
+    Frame frame;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            frame.pixels[y][x] = (x * 7 + y * 3 + x / 5) % 4;
+        }
+    }
+
+    SECTION("RGBA8888 with padded pitch") {
+        FrameConverter converter(PixelFormat::RGBA8888, palette);
+        size_t pitch = SCREEN_WIDTH * 4 + 12;
+        std::vector<uint8_t> out(pitch * SCREEN_HEIGHT, 0xCC);
+        converter.convert(frame, out.data(), pitch);
+
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            for (int x = 0; x < SCREEN_WIDTH; x++) {
+                uint32_t color = palette[frame.pixels[y][x]];
+                const uint8_t *px = &out[y * pitch + x * 4];
+                REQUIRE(px[0] == ((color >> 16) & 0xFF));
+                REQUIRE(px[1] == ((color >> 8) & 0xFF));
+                REQUIRE(px[2] == (color & 0xFF));
+                REQUIRE(px[3] == 0xFF);
+            }
+            REQUIRE(out[y * pitch + SCREEN_WIDTH * 4] == 0xCC);
+        }
+    }
+
+    SECTION("RGB565") {
+        FrameConverter converter(PixelFormat::RGB565, palette);
+        std::vector<uint16_t> out(SCREEN_WIDTH * SCREEN_HEIGHT);
+        converter.convert(frame, out.data(), SCREEN_WIDTH * 2);
+
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            for (int x = 0; x < SCREEN_WIDTH; x++) {
+                uint32_t color = palette[frame.pixels[y][x]];
+                uint16_t expected = (((color >> 19) & 0x1F) << 11) | (((color >> 10) & 0x3F) << 5) | ((color >> 3) & 0x1F);
+                REQUIRE(out[y * SCREEN_WIDTH + x] == expected);
+            }
+        }
+    }
+
+    SECTION("GRAYSCALE8") {
+        FrameConverter converter(PixelFormat::GRAYSCALE8);
+        std::vector<uint8_t> out(SCREEN_WIDTH * SCREEN_HEIGHT);
+        converter.convert(frame, out.data(), SCREEN_WIDTH);
+
+        const uint8_t expected[4] = { 0xFF, 0xAA, 0x55, 0x00 };
+        for (int y = 0; y < SCREEN_HEIGHT; y++) {
+            for (int x = 0; x < SCREEN_WIDTH; x++) {
+                REQUIRE(out[y * SCREEN_WIDTH + x] == expected[frame.pixels[y][x]]);
+            }
+        }
+    }
+}
+
+TEST_CASE("FrameConverter converts only the requested lines") {
+    Frame frame;
+    std::vector<uint8_t> out(SCREEN_WIDTH * SCREEN_HEIGHT, 0x42);
+    frame.dirty_lines.set(5);
+
+    FrameConverter(PixelFormat::GRAYSCALE8).convert(frame, out.data(), SCREEN_WIDTH, &frame.dirty_lines);
+    REQUIRE(out[4 * SCREEN_WIDTH] == 0x42);
+    REQUIRE(out[5 * SCREEN_WIDTH] == 0xFF);
+    REQUIRE(out[6 * SCREEN_WIDTH] == 0x42);
+}
+
+TEST_CASE("SharedFrameRing publishes frames to a reader") {
+    const std::string name = "/gbemu_test_ring_" + std::to_string(getpid());
+    SharedFrameRing ring;
+    REQUIRE_FALSE(ring.create(name, PixelFormat::GRAYSCALE8, 0));
+    REQUIRE(ring.create(name, PixelFormat::GRAYSCALE8, 2, 4));
+
+    SharedFrameReader reader;
+    REQUIRE(reader.open(name));
+    REQUIRE(reader.latest() == 0);
+
+    Frame frame;
+    const int16_t audio[8] = { 1, -1, 2, -2, 3, -3, 4, -4 };
+    for (uint64_t n = 1; n <= 3; n++) {
+        frame.number = n;
+        frame.pixels[0][0] = n % 4;
+        frame.dirty_lines.reset();
+        frame.dirty_lines.set(0);
+        ring.publish(frame, audio, 4);
+    }
+
+    uint64_t latest = reader.latest();
+    REQUIRE(latest == 3);
+    const ShmSlotHeader *slot = nullptr;
+    const uint8_t *pixels = reader.begin_read(latest, &slot);
+    REQUIRE(pixels != nullptr);
+    REQUIRE(slot->frame_number == 3);
+    REQUIRE(pixels[0] == 0x00);  // shade 3 is black
+    REQUIRE(slot->audio_frames == 4);
+    REQUIRE(slot->dirty_lines[0] == 1);
+    REQUIRE(std::memcmp(pixels + SCREEN_WIDTH * SCREEN_HEIGHT, audio, sizeof(audio)) == 0);
+    REQUIRE(reader.end_read(latest));
+
+    // Frame 1 shared a slot with frame 3 and is gone
+    REQUIRE(reader.begin_read(1) == nullptr);
+}
+
+TEST_CASE("xxh64 reference values") {
+    REQUIRE(xxh64("", 0) == 0xEF46DB3751D8E999ULL);
+    REQUIRE(xxh64("abc", 3) == 0x44BC2CF5AD770999ULL);
+
+    Frame a, b;
+    REQUIRE(hash_frame(a) == hash_frame(b));
+    b.pixels[SCREEN_HEIGHT - 1][SCREEN_WIDTH - 1] = 1;
+    REQUIRE(hash_frame(a) != hash_frame(b));
+}
@@ -0,0 +1,110 @@
+#include <catch2/catch_test_macros.hpp>
+#include <bitset>
+#include <cmath>
+#include <vector>
+#include "hash.h"
+#include "input_search.h"
+#include "run_ahead.h"
+#include "test_programs.h"
+
+/* The number of joypad lines low in the latest P1 value the program logged */
+static double pressed_lines(CPU &cpu) {
+    Bus *bus = cpu.get_bus();
+    uint8_t latest = bus->read_n8(0xC000 + static_cast<uint8_t>(cpu.get_state().BC.r8.lo - 1));
+    return std::bitset<4>(~latest & 0x0F).count();
+}
+
+static const std::vector<uint8_t> CHOICES = {
+    0,
+    BUTTON_A | BUTTON_RIGHT,                // Both on line 0
+    BUTTON_B | BUTTON_UP | BUTTON_START,    // Lines 1, 2 and 3
+    BUTTON_A,
+};
+
+TEST_CASE("Expanded children match running each choice alone", "[input_search]") {
+    CPU cpu;
+    boot_joypad(cpu);
+    for (int i = 0; i < 5; i++) {
+        run_to_frame_end(cpu);
+    }
+    Snapshot root;
+    cpu.get_bus()->save_snapshot(root);
+
+    InputSearch search(cpu, 3);
+    REQUIRE(search.get_threads() == 3);
+    std::vector<SearchChild> children = search.expand(root, CHOICES, 4, pressed_lines, true);
+    REQUIRE(children.size() == CHOICES.size());
+
+    for (size_t i = 0; i < CHOICES.size(); i++) {
+        CPU alone;
+        boot_joypad(alone);
+        alone.get_bus()->load_snapshot(root);
+        alone.get_bus()->set_buttons(CHOICES[i]);
+        for (int frame = 0; frame < 4; frame++) {
+            run_to_frame_end(alone);
+        }
+
+        CPU kept;
+        boot_joypad(kept);
+        kept.get_bus()->load_snapshot(*children[i].STATE);
+        REQUIRE(children[i].BUTTONS == CHOICES[i]);
+        REQUIRE_FALSE(children[i].FAILED);
+        REQUIRE(children[i].SCORE == pressed_lines(alone));
+        REQUIRE(hash_machine(kept) == hash_machine(alone));
+    }
+    REQUIRE(children[0].SCORE == 0);
+    REQUIRE(children[2].SCORE == 3);
+
+    REQUIRE(search.get_stats().CHILDREN == 4);
+    REQUIRE(search.get_stats().FRAMES == 16);
+    for (SearchChild &child : children) {
+        search.recycle(std::move(child.STATE));
+    }
+}
+
+TEST_CASE("Beam search finds the best-scoring input sequence", "[input_search]") {
+    CPU cpu;
+    boot_joypad(cpu);
+    run_to_frame_end(cpu);
+    Snapshot root;
+    cpu.get_bus()->save_snapshot(root);
+
+    InputSearch search(cpu, 4);
+    SearchPath path = search.beam_search(root, CHOICES, 2, 3, 2, pressed_lines);
+    REQUIRE(path.INPUTS.size() == 3);
+    REQUIRE(path.INPUTS.back() == CHOICES[2]);
+    REQUIRE(path.SCORE == 3);
+
+    // One level of 4 children, then two of 2 x 4
+    REQUIRE(search.get_stats().CHILDREN == 4 + 8 + 8);
+
+    // Replaying the path reaches the score it was found with
+    CPU replay;
+    boot_joypad(replay);
+    replay.get_bus()->load_snapshot(root);
+    for (uint8_t buttons : path.INPUTS) {
+        replay.get_bus()->set_buttons(buttons);
+        run_to_frame_end(replay);
+        run_to_frame_end(replay);
+    }
+    REQUIRE(pressed_lines(replay) == path.SCORE);
+}
+
+TEST_CASE("Children of a hung machine fail", "[input_search]") {
+    static const uint8_t HALT[] = { 0x76 };
+    CPU cpu;
+    cpu.get_bus()->get_cartridge()->load(const_cast<uint8_t *>(HALT), sizeof(HALT));
+    Snapshot root;
+    cpu.get_bus()->save_snapshot(root);
+
+    InputSearch search(cpu, 2);
+    std::vector<SearchChild> children = search.expand(root, CHOICES, 3, pressed_lines);
+    for (const SearchChild &child : children) {
+        REQUIRE(child.FAILED);
+        REQUIRE(std::isinf(child.SCORE));
+        REQUIRE(child.STATE == nullptr);
+    }
+    SearchPath path = search.beam_search(root, CHOICES, 3, 2, 2, pressed_lines);
+    REQUIRE(path.INPUTS.empty());
+    REQUIRE(std::isinf(path.SCORE));
+}
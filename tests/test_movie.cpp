@@ -0,0 +1,142 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+#include "hash.h"
+#include "movie.h"
+#include "run_ahead.h"
+#include "savestate.h"
+#include "test_programs.h"
+
+static uint8_t input(uint32_t frame) { return (frame / 4) % 3 ? BUTTON_A << (frame % 4) : BUTTON_DOWN; }
+
+/* Records @frames frames of input() on @cpu, returning the state hash at the end */
+static uint64_t record(CPU &cpu, const std::string &path, uint32_t frames, uint32_t interval,
+                       const std::string &start_state = "") {
+    MovieWriter writer;
+    REQUIRE(writer.open(path, cpu, interval, start_state));
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        cpu.get_bus()->set_buttons(input(frame));
+        run_to_frame_end(cpu);
+        writer.write_frame(input(frame), cpu);
+    }
+    REQUIRE(writer.get_frames() == frames);
+    REQUIRE(writer.close());
+    return hash_machine(cpu);
+}
+
+TEST_CASE("A movie is one byte per frame plus its state hashes", "[movie]") {
+    std::string path = temp_path("gameboy_test_movie.gbm");
+    CPU cpu;
+    boot_joypad(cpu);
+    record(cpu, path, 25, 10);
+
+    std::vector<uint8_t> bytes = read_file(path);
+    REQUIRE(bytes.size() == sizeof(MovieHeader) + 25 + 2 * sizeof(uint64_t));
+
+    MovieReader reader;
+    REQUIRE(reader.open(path));
+    REQUIRE(reader.get_header().FRAME_COUNT == 25);
+    REQUIRE(reader.get_header().HASH_INTERVAL == 10);
+    REQUIRE(reader.get_start_state().empty());
+
+    uint8_t buttons;
+    bool check;
+    uint64_t hash;
+    for (uint32_t frame = 0; frame < 25; frame++) {
+        REQUIRE(reader.read_frame(buttons, check, hash));
+        REQUIRE(buttons == input(frame));
+        REQUIRE(check == (frame == 9 || frame == 19));
+    }
+    REQUIRE_FALSE(reader.read_frame(buttons, check, hash));
+    REQUIRE_FALSE(reader.is_damaged());
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Replaying a movie reproduces the recorded run exactly", "[movie]") {
+    std::string path = temp_path("gameboy_test_replay.gbm");
+    CPU recorded;
+    boot_joypad(recorded);
+    uint64_t final_hash = record(recorded, path, 120, 8);
+
+    // Headless and silent, as a batch replay runs
+    CPU replayed;
+    boot_joypad(replayed);
+    replayed.get_bus()->get_ppu()->set_rendering(false);
+    replayed.get_bus()->get_apu()->set_synthesis(false);
+
+    MovieReader reader;
+    REQUIRE(reader.open(path));
+    MovieReplay result;
+    REQUIRE(replay_movie(reader, replayed, result));
+    REQUIRE(result.FRAMES == 120);
+    REQUIRE(result.VERIFIED == 15);
+    REQUIRE(result.DESYNC_FRAME == -1);
+    REQUIRE(hash_machine(replayed) == final_hash);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Replay stops at the first hash that does not match", "[movie]") {
+    std::string path = temp_path("gameboy_test_desync.gbm");
+    CPU recorded;
+    boot_joypad(recorded);
+    record(recorded, path, 40, 5);
+
+    // Change the input of the 15th frame, the last one before the third hash. The program only
+    // keeps the latest input in its ring, so the state must be hashed right after the change
+    std::vector<uint8_t> bytes = read_file(path);
+    bytes[sizeof(MovieHeader) + 14 + 2 * sizeof(uint64_t)] ^= BUTTON_B;
+    write_file(path, bytes);
+
+    CPU replayed;
+    boot_joypad(replayed);
+    MovieReader reader;
+    REQUIRE(reader.open(path));
+    MovieReplay result;
+    REQUIRE_FALSE(replay_movie(reader, replayed, result));
+    REQUIRE(result.DESYNC_FRAME == 15);
+    REQUIRE(result.VERIFIED == 2);
+
+    // A truncated movie is damaged rather than short
+    bytes.resize(bytes.size() - 10);
+    write_file(path, bytes);
+    REQUIRE(reader.open(path));
+    uint8_t buttons;
+    bool check;
+    uint64_t hash;
+    while (reader.read_frame(buttons, check, hash)) {
+    }
+    REQUIRE(reader.is_damaged());
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("A movie starts from its savestate and only plays on its ROM", "[movie]") {
+    std::string state_path = temp_path("gameboy_test_movie_start.gbs");
+    std::string path = temp_path("gameboy_test_movie_start.gbm");
+    CPU recorded;
+    boot_joypad(recorded);
+    for (int i = 0; i < 7; i++) {
+        run_to_frame_end(recorded);
+    }
+    REQUIRE(save_state(state_path, *recorded.get_bus()));
+    uint64_t final_hash = record(recorded, path, 30, 6, state_path);
+
+    CPU replayed;
+    boot_joypad(replayed);
+    MovieReader reader;
+    REQUIRE(reader.open(path));
+    REQUIRE(reader.get_start_state() == state_path);
+    MovieReplay result;
+    REQUIRE(replay_movie(reader, replayed, result));
+    REQUIRE(result.VERIFIED == 5);
+    REQUIRE(hash_machine(replayed) == final_hash);
+
+    CPU other;
+    boot_joypad(other);
+    other.get_bus()->get_cartridge()->write_n8(0x100, 0x76);
+    REQUIRE(reader.open(path));
+    REQUIRE_FALSE(replay_movie(reader, other, result));
+    REQUIRE(result.FRAMES == 0);
+    std::filesystem::remove(path);
+    std::filesystem::remove(state_path);
+}
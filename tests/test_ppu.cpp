@@ -0,0 +1,118 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <vector>
+#include "cpu.h"
+
+/* Runs the machine clock forward without executing instructions. */
+static void advance(CPU &cpu, uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; i++) {
+        cpu.get_state().MCYCLES++;
+        cpu.get_bus()->tick();
+    }
+}
+
+/* Fills VRAM with a few distinct tiles, a tile map, a sprite and a window, then runs frames with
+ * mid-frame scroll and palette writes so the renderer has to see writes in the right order. Stops
+ * partway into the fourth frame and leaves the PPU state in @state. */
+static std::vector<Frame> run_scene(bool pipelined, PPUState &state) {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    std::vector<Frame> frames;
+
+    bus->get_ppu()->set_frame_callback([&frames](const Frame &frame) { frames.push_back(frame); });
+    bus->get_ppu()->set_pipelined(pipelined);
+
+    for (uint16_t i = 0; i < 0x200; i++) {
+        bus->write_n8(0x8000 + i, (uint8_t)(i * 37));
+    }
+    for (uint16_t i = 0; i < 0x400; i++) {
+        bus->write_n8(0x9800 + i, (uint8_t)(i % 32));
+    }
+    bus->write_n8(0xFE00, 40);  // Sprite 0: Y
+    bus->write_n8(0xFE01, 30);  // Sprite 0: X
+    bus->write_n8(0xFE02, 3);   // Sprite 0: tile
+    bus->write_n8(0xFF47, 0xE4);
+    bus->write_n8(0xFF48, 0x1B);
+    bus->write_n8(0xFF4A, 20);  // WY
+    bus->write_n8(0xFF4B, 50);  // WX
+    bus->write_n8(0xFF40, 0xB3);
+
+    for (int line = 0; line < 154 * 3 + 60; line++) {
+        advance(cpu, 37);
+        bus->write_n8(0xFF43, (uint8_t)(line * 3));
+        advance(cpu, 40);
+        bus->write_n8(0x8000 + (line % 0x200), (uint8_t)line);
+        if (line % 50 == 0) {
+            bus->write_n8(0xFF47, (uint8_t)(0xE4 ^ line));
+        }
+        advance(cpu, PPU_LINE_CYCLES - 77);
+    }
+
+    bus->get_ppu()->flush();
+    bus->get_ppu()->set_pipelined(false);
+    state = bus->get_ppu()->get_state();
+    return frames;
+}
+
+TEST_CASE("PPU LY and STAT follow the scheduler") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    bus->write_n8(0xFF40, 0x91);
+
+    REQUIRE((bus->read_n8(0xFF41) & 0b11) == PPU_MODE_OAM_SCAN);
+    advance(cpu, PPU_OAM_SCAN_CYCLES);
+    REQUIRE((bus->read_n8(0xFF41) & 0b11) == PPU_MODE_TRANSFER);
+    advance(cpu, PPU_LINE_CYCLES - PPU_OAM_SCAN_CYCLES);
+    REQUIRE(bus->read_n8(0xFF44) == 1);
+
+    advance(cpu, PPU_LINE_CYCLES * 143);
+    REQUIRE(bus->read_n8(0xFF44) == 144);
+    REQUIRE((bus->read_n8(0xFF41) & 0b11) == PPU_MODE_VBLANK);
+    REQUIRE((cpu.get_state().IF & 0x01) == 0x01);
+
+    advance(cpu, PPU_LINE_CYCLES * 10);
+    REQUIRE(bus->read_n8(0xFF44) == 0);
+    REQUIRE(bus->get_ppu()->get_state().FRAMES == 1);
+}
+
+TEST_CASE("Pipelined PPU renders the same frames as the synchronous PPU") {
+    PPUState sync_state, pipelined_state;
+    std::vector<Frame> sync = run_scene(false, sync_state);
+    std::vector<Frame> pipelined = run_scene(true, pipelined_state);
+
+    REQUIRE(sync.size() == 3);
+    REQUIRE(pipelined.size() == sync.size());
+    for (size_t i = 0; i < sync.size(); i++) {
+        REQUIRE(pipelined[i].number == sync[i].number);
+        REQUIRE(std::memcmp(pipelined[i].pixels, sync[i].pixels, sizeof(sync[i].pixels)) == 0);
+    }
+
+    // The CPU-side state, which snapshots and state hashes see, does not depend on the renderer
+    REQUIRE(sync_state.WINDOW_LINE > 0);
+    REQUIRE(pipelined_state.WINDOW_LINE == sync_state.WINDOW_LINE);
+    REQUIRE(std::memcmp(&pipelined_state, &sync_state, sizeof(PPUState)) == 0);
+}
+
+TEST_CASE("PPU marks only the lines that changed since the previous frame") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    std::vector<Frame> frames;
+    bus->get_ppu()->set_frame_callback([&frames](const Frame &frame) { frames.push_back(frame); });
+
+    bus->write_n8(0x8010, 0xFF);  // Tile 1, row 0
+    bus->write_n8(0x9800, 1);     // Top-left map entry
+    bus->write_n8(0xFF47, 0xE4);
+    bus->write_n8(0xFF40, 0x91);
+    advance(cpu, PPU_FRAME_CYCLES * 2);
+
+    REQUIRE(frames.size() == 2);
+    REQUIRE(frames[0].dirty_lines.all());
+    REQUIRE(frames[1].dirty_lines.none());
+
+    bus->write_n8(0x8012, 0xFF);  // Tile 1, row 1
+    advance(cpu, PPU_FRAME_CYCLES);
+
+    REQUIRE(frames.size() == 3);
+    REQUIRE(frames[2].dirty_lines.count() == 1);
+    REQUIRE(frames[2].dirty_lines.test(1));
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "cpu.h"
+
+/* With A = 0x80: turns on the LCD and the APU, then counts in HRAM and BGP forever. */
+inline constexpr uint8_t COUNTER_PROGRAM[] = {
+    0xE0, 0x40,         // LDH (LCDC), A
+    0xE0, 0x26,         // LDH (NR52), A
+    0x3C,               // loop: INC A
+    0xE0, 0x80,         // LDH (0x80), A
+    0xE0, 0x47,         // LDH (BGP), A
+    0x18, 0xF9,         // JR loop
+};
+
+/* With A = 0x80: turns on the LCD, selects both joypad groups and logs P1 into a 256-byte ring at BC. */
+inline constexpr uint8_t JOYPAD_PROGRAM[] = {
+    0xE0, 0x40,         // LDH (LCDC), A
+    0xE0, 0x00,         // LDH (P1), A
+    0xF0, 0x00,         // loop: LDH A, (P1)
+    0x02,               // LD (BC), A
+    0x0C,               // INC C
+    0x18, 0xFA,         // JR loop
+};
+
+/* Loads COUNTER_PROGRAM with the timer running */
+inline void boot_counter(CPU &cpu) {
+    cpu.get_bus()->get_cartridge()->load(const_cast<uint8_t *>(COUNTER_PROGRAM), sizeof(COUNTER_PROGRAM));
+    cpu.get_bus()->write_n8(0xFF07, 0x05);
+    cpu.get_state().AF.r8.hi = 0x80;
+}
+
+/* Loads JOYPAD_PROGRAM with its ring at the start of WRAM */
+inline void boot_joypad(CPU &cpu) {
+    cpu.get_bus()->get_cartridge()->load(const_cast<uint8_t *>(JOYPAD_PROGRAM), sizeof(JOYPAD_PROGRAM));
+    cpu.get_state().AF.r8.hi = 0x80;
+    cpu.get_state().BC.r16 = 0xC000;
+}
+
+/* Writes a pattern into every 7th byte of WRAM and cartridge RAM */
+inline void fill_ram(CPU &cpu) {
+    for (int i = 0; i < 0x2000; i += 7) {
+        cpu.get_bus()->write_n8(0xC000 + i, i);
+        cpu.get_bus()->write_n8(0xA000 + i, ~i);
+    }
+}
+
+inline void run(CPU &cpu, int steps) {
+    for (int i = 0; i < steps; i++) {
+        cpu.step();
+    }
+}
+
+inline std::string temp_path(const char *name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+inline std::vector<uint8_t> read_file(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+inline void write_file(const std::string &path, const std::vector<uint8_t> &data) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
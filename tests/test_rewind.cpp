@@ -0,0 +1,103 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <vector>
+#include "cpu.h"
+#include "rewind.h"
+#include "test_programs.h"
+
+/* Runs to the end of the frame, then changes a few bytes of WRAM the way a game would. */
+static void run_frame(CPU &cpu) {
+    uint64_t frames = cpu.get_bus()->get_ppu()->get_state().FRAMES;
+    while (cpu.get_bus()->get_ppu()->get_state().FRAMES == frames) {
+        cpu.step();
+    }
+    for (int i = 0; i < 16; i++) {
+        cpu.get_bus()->write_n8(0xC000 + ((frames * 97 + i * 13) & 0x1FFF), frames + i);
+    }
+}
+
+TEST_CASE("Rewind steps back through every recorded frame", "[rewind]") {
+    CPU cpu;
+    boot_counter(cpu);
+    Rewind rewind(4 << 20, 1, 16);
+    std::vector<Snapshot> history(40);
+
+    for (Snapshot &snapshot : history) {
+        run_frame(cpu);
+        cpu.get_bus()->save_snapshot(snapshot);
+        rewind.push(snapshot);
+    }
+    REQUIRE(rewind.size() == history.size());
+    REQUIRE(rewind.memory_used() < sizeof(Snapshot) * 4);
+
+    Snapshot snapshot;
+    for (size_t i = history.size(); i-- > 0;) {
+        REQUIRE(rewind.pop(snapshot));
+        REQUIRE(std::memcmp(&snapshot, &history[i], sizeof(Snapshot)) == 0);
+    }
+    REQUIRE_FALSE(rewind.pop(snapshot));
+    REQUIRE(rewind.memory_used() == 0);
+}
+
+TEST_CASE("Rewind continues correctly after stepping back", "[rewind]") {
+    CPU cpu;
+    boot_counter(cpu);
+    Rewind rewind(4 << 20, 2, 4);
+    Snapshot expected;
+
+    for (int i = 0; i < 20; i++) {
+        run_frame(cpu);
+        rewind.on_frame(*cpu.get_bus());
+    }
+    REQUIRE(rewind.size() == 10);
+
+    // Back three recordings, then forward along a new timeline
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(rewind.rewind(*cpu.get_bus()));
+    }
+    REQUIRE(rewind.size() == 7);
+    REQUIRE(cpu.get_bus()->get_ppu()->get_state().FRAMES == 16);
+    for (int i = 0; i < 2; i++) {
+        run_frame(cpu);
+        rewind.on_frame(*cpu.get_bus());
+    }
+    cpu.get_bus()->save_snapshot(expected);
+    REQUIRE(rewind.size() == 8);
+
+    Snapshot snapshot;
+    REQUIRE(rewind.pop(snapshot));
+    REQUIRE(std::memcmp(&snapshot, &expected, sizeof(Snapshot)) == 0);
+    REQUIRE(rewind.pop(snapshot));
+    REQUIRE(snapshot.PPU.FRAMES == 14);
+}
+
+TEST_CASE("Rewind drops whole keyframe groups to stay in budget", "[rewind]") {
+    CPU cpu;
+    boot_counter(cpu);
+    std::vector<Snapshot> history(24);
+    for (Snapshot &snapshot : history) {
+        run_frame(cpu);
+        cpu.get_bus()->save_snapshot(snapshot);
+    }
+
+    Rewind unbounded(64 << 20, 1, 8);
+    for (Snapshot &snapshot : history) {
+        unbounded.push(snapshot);
+    }
+    size_t budget = unbounded.memory_used() / 2;
+
+    Rewind rewind(budget, 1, 8);
+    for (Snapshot &snapshot : history) {
+        rewind.push(snapshot);
+        REQUIRE((rewind.memory_used() <= budget || rewind.size() <= 8));
+    }
+    REQUIRE(rewind.size() % 8 == 0);
+    REQUIRE(rewind.size() < history.size());
+
+    Snapshot snapshot;
+    size_t kept = rewind.size();
+    for (size_t i = 0; i < kept; i++) {
+        REQUIRE(rewind.pop(snapshot));
+        REQUIRE(std::memcmp(&snapshot, &history[history.size() - 1 - i], sizeof(Snapshot)) == 0);
+    }
+}
@@ -0,0 +1,222 @@
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <ctime>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "hash.h"
+#include "rollback.h"
+#include "run_ahead.h"
+#include "test_programs.h"
+
+static uint8_t player0(uint32_t frame) { return (frame / 3) % 2 ? BUTTON_A : 0; }
+static uint8_t player1(uint32_t frame) { return frame % 5 == 0 ? BUTTON_RIGHT | BUTTON_START : 0; }
+
+TEST_CASE("FdTransport carries packets over a pipe and a socket", "[rollback]") {
+    int pipe_fds[2];
+    REQUIRE(pipe(pipe_fds) == 0);
+    FdTransport over_pipe(pipe_fds[0], pipe_fds[1]);
+
+    int socket_fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds) == 0);
+    FdTransport left(socket_fds[0], socket_fds[0]);
+    FdTransport right(socket_fds[1], socket_fds[1]);
+
+    InputPacket packet;
+    REQUIRE_FALSE(over_pipe.receive(packet));
+    REQUIRE(over_pipe.send(InputPacket { 7, BUTTON_B, {} }));
+    REQUIRE(over_pipe.receive(packet));
+    REQUIRE(packet.FRAME == 7);
+    REQUIRE(packet.BUTTONS == BUTTON_B);
+
+    REQUIRE(left.send(InputPacket { 1, BUTTON_UP, {} }));
+    REQUIRE(left.send(InputPacket { 2, BUTTON_DOWN, {} }));
+    REQUIRE(right.receive(packet));
+    REQUIRE(packet.FRAME == 1);
+    REQUIRE(right.receive(packet));
+    REQUIRE(packet.BUTTONS == BUTTON_DOWN);
+    REQUIRE_FALSE(right.receive(packet));
+    REQUIRE_FALSE(right.is_closed());
+
+    // Closing the writing end shows as the end of the stream, after the packets still queued
+    REQUIRE(left.send(InputPacket { 3, BUTTON_A, {} }));
+    close(socket_fds[0]);
+    REQUIRE(right.receive(packet));
+    REQUIRE(packet.FRAME == 3);
+    REQUIRE_FALSE(right.receive(packet));
+    REQUIRE(right.is_closed());
+    close(pipe_fds[1]);
+    REQUIRE_FALSE(over_pipe.receive(packet));
+    REQUIRE(over_pipe.is_closed());
+
+    for (int fd : { pipe_fds[0], socket_fds[1] }) {
+        close(fd);
+    }
+}
+
+TEST_CASE("FdTransport waits for room in a full socket without spinning", "[rollback]") {
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    FdTransport left(fds[0], fds[0]);
+    FdTransport right(fds[1], fds[1]);
+    const uint32_t count = 1 << 17;     // Far more than the socket buffers hold
+
+    bool sent = true;
+    double sender_cpu = 0;
+    std::thread sender([&] {
+        for (uint32_t frame = 0; frame < count; frame++) {
+            sent = sent && left.send(InputPacket { frame, 0, {} });
+        }
+        timespec cpu;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+        sender_cpu = cpu.tv_sec + cpu.tv_nsec / 1e9;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    InputPacket packet;
+    uint32_t received = 0;
+    while (received < count) {
+        if (right.receive(packet)) {
+            if (packet.FRAME != received) {
+                break;
+            }
+            received++;
+        }
+    }
+    REQUIRE(received == count);
+    sender.join();
+    REQUIRE(sent);
+    REQUIRE(sender_cpu < 0.15);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE("Rollback sessions converge on the state of the real inputs", "[rollback]") {
+    const uint32_t frames = 40;
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    FdTransport transport0(fds[0], fds[0]);
+    FdTransport transport1(fds[1], fds[1]);
+
+    CPU cpu0, cpu1, reference;
+    boot_joypad(cpu0);
+    boot_joypad(cpu1);
+    boot_joypad(reference);
+    RollbackSession side0(cpu0, transport0, 0, 6);
+    RollbackSession side1(cpu1, transport1, 1, 6);
+    uint32_t drawn = 0;
+    cpu0.get_bus()->get_ppu()->set_frame_callback([&drawn](const Frame &) { drawn++; });
+
+    // Side 1 runs at a third of side 0's pace until side 0 has to wait for it
+    while (side0.get_frame() < frames || side1.get_frame() < frames) {
+        for (int i = 0; i < 3 && side0.get_frame() < frames; i++) {
+            side0.advance(player0(side0.get_frame()));
+        }
+        if (side1.get_frame() < frames) {
+            side1.advance(player1(side1.get_frame()));
+        }
+    }
+    side0.poll();
+    side1.poll();
+    REQUIRE(side0.get_confirmed_frames() == frames);
+    REQUIRE(side1.get_confirmed_frames() == frames);
+    REQUIRE(side0.get_stats().ROLLBACKS > 0);
+    REQUIRE(side1.get_stats().ROLLBACKS == 0);     // Side 0's input was always there in time
+    REQUIRE(side0.get_stats().MAX_DEPTH <= 6);
+    REQUIRE(drawn == frames + side0.get_stats().ROLLBACKS);    // Every rollback redraws its last frame
+
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        reference.get_bus()->set_buttons(player0(frame) | player1(frame));
+        run_to_frame_end(reference);
+    }
+    REQUIRE(hash_machine(cpu0) == hash_machine(reference));
+    REQUIRE(hash_machine(cpu1) == hash_machine(reference));
+
+    // The input actually reached the game
+    bool pressed = false;
+    for (int i = 0; i < 0x100; i++) {
+        pressed |= reference.get_bus()->read_n8(0xC000 + i) != 0xCF;
+    }
+    REQUIRE(pressed);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE("A correction saves a machine that hung on a predicted input", "[rollback]") {
+    // With A = 0x80: turns on the LCD and selects both joypad groups, then loops while A or
+    // Right is held and hangs in a JR to itself once neither is
+    static const uint8_t HANG_ON_RELEASE[] = {
+        0xE0, 0x40,         // LDH (LCDC), A
+        0xE0, 0x00,         // LDH (P1), A
+        0xF0, 0x00,         // loop: LDH A, (P1)
+        0xE6, 0x01,         // AND 0x01
+        0x28, 0xFA,         // JR Z, loop
+        0x18, 0xFE,         // JR to itself
+    };
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    FdTransport transport0(fds[0], fds[0]);
+    FdTransport transport1(fds[1], fds[1]);
+
+    CPU cpu0, cpu1, reference;
+    for (CPU *cpu : { &cpu0, &cpu1, &reference }) {
+        cpu->get_bus()->get_cartridge()->load(const_cast<uint8_t *>(HANG_ON_RELEASE), sizeof(HANG_ON_RELEASE));
+        cpu->get_state().AF.r8.hi = 0x80;
+    }
+    RollbackSession side0(cpu0, transport0, 0, 6);
+    RollbackSession side1(cpu1, transport1, 1, 6);
+
+    // Side 0 predicts no input from side 1 before it has heard from it, and hangs
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(side0.advance(0));
+    }
+    REQUIRE(cpu0.get_stuck_reason() != nullptr);
+    REQUIRE_FALSE(side0.is_stuck());
+
+    // Side 1 holds A all along, so the rollback un-hangs side 0
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(side1.advance(BUTTON_A));
+    }
+    side0.poll();
+    REQUIRE(side0.get_stats().ROLLBACKS == 1);
+    REQUIRE(cpu0.get_stuck_reason() == nullptr);
+    REQUIRE_FALSE(side0.is_stuck());
+    reference.get_bus()->set_buttons(BUTTON_A);
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(run_to_frame_end(reference));
+    }
+    REQUIRE(hash_machine(cpu0) == hash_machine(reference));
+
+    // A hang on confirmed input is final
+    REQUIRE(side0.advance(0));
+    REQUIRE(side1.advance(0));
+    REQUIRE_FALSE(side0.advance(0));
+    REQUIRE(side0.is_stuck());
+    REQUIRE(side0.is_connected());
+    REQUIRE(side0.get_frame() == 4);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_CASE("A session does not run further ahead than it can roll back", "[rollback]") {
+    int fds[2];
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    FdTransport transport(fds[0], fds[0]);
+    CPU cpu;
+    boot_joypad(cpu);
+    RollbackSession session(cpu, transport, 0, 3);
+
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(session.advance(0));
+    }
+    REQUIRE_FALSE(session.advance(0));
+    REQUIRE(session.get_frame() == 3);
+    REQUIRE(session.is_connected());
+
+    close(fds[1]);
+    REQUIRE_FALSE(session.advance(0));
+    REQUIRE_FALSE(session.is_connected());
+    close(fds[0]);
+}
@@ -0,0 +1,120 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "hash.h"
+#include "run_ahead.h"
+#include "test_programs.h"
+
+struct Recorder {
+    std::vector<uint64_t> numbers;
+    std::unique_ptr<Frame> last = std::make_unique<Frame>();
+    std::vector<int16_t> samples;
+
+    void attach(CPU &cpu) {
+        cpu.get_bus()->get_ppu()->set_frame_callback([this](const Frame &frame) {
+            numbers.push_back(frame.number);
+            std::memcpy(last->pixels, frame.pixels, sizeof(frame.pixels));
+        });
+        cpu.get_bus()->get_apu()->set_audio_callback([this](const int16_t *data, size_t frames) {
+            samples.insert(samples.end(), data, data + frames * 2);
+        });
+    }
+};
+
+TEST_CASE("The joypad shows the selected group and interrupts on a press", "[joypad]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    REQUIRE(bus->read_n8(0xFF00) == 0xFF);
+
+    bus->write_n8(0xFF00, 0x20);
+    bus->set_buttons(BUTTON_RIGHT | BUTTON_B);
+    REQUIRE(bus->read_n8(0xFF00) == 0xEE);
+    REQUIRE(cpu.get_state().IF == 0x10);
+
+    bus->write_n8(0xFF00, 0x10);
+    REQUIRE(bus->read_n8(0xFF00) == 0xDD);
+
+    // Pressing a button of the group that is not selected changes nothing the game can see
+    cpu.get_state().IF = 0;
+    bus->set_buttons(BUTTON_RIGHT | BUTTON_B | BUTTON_DOWN);
+    REQUIRE(bus->read_n8(0xFF00) == 0xDD);
+    REQUIRE(cpu.get_state().IF == 0);
+
+    bus->write_n8(0xFF00, 0x30);
+    REQUIRE(bus->read_n8(0xFF00) == 0xFF);
+}
+
+TEST_CASE("A headless PPU keeps the same state as a rendering one", "[run_ahead]") {
+    CPU rendering, headless;
+    boot_counter(rendering);
+    boot_counter(headless);
+    for (CPU *cpu : { &rendering, &headless }) {
+        Bus *bus = cpu->get_bus();
+        bus->write_n8(0xFF4A, 40);      // WY
+        bus->write_n8(0xFF4B, 87);      // WX
+        bus->write_n8(0xFF40, 0xA1);    // LCD, window and background on
+    }
+    headless.get_bus()->get_ppu()->set_rendering(false);
+    for (int i = 0; i < 3; i++) {
+        run_to_frame_end(rendering);
+        run_to_frame_end(headless);
+    }
+    const PPUState &a = rendering.get_bus()->get_ppu()->get_state();
+    const PPUState &b = headless.get_bus()->get_ppu()->get_state();
+    REQUIRE(a.FRAMES == b.FRAMES);
+    REQUIRE(a.LY == b.LY);
+    REQUIRE(a.WINDOW_LINE == b.WINDOW_LINE);
+    REQUIRE(std::memcmp(&a, &b, sizeof(PPUState)) == 0);
+}
+
+TEST_CASE("Run-ahead presents future frames without changing the real run", "[run_ahead]") {
+    const unsigned frames = 2;
+    CPU plain, ahead;
+    boot_counter(plain);
+    boot_counter(ahead);
+    Recorder plain_out, ahead_out;
+    plain_out.attach(plain);
+    ahead_out.attach(ahead);
+
+    RunAhead run_ahead(frames);
+    std::vector<std::unique_ptr<Frame>> plain_frames, ahead_frames;
+    for (int i = 0; i < 6; i++) {
+        run_ahead.run_frame(ahead);
+        run_to_frame_end(plain);
+
+        uint64_t real = ahead.get_bus()->get_ppu()->get_state().FRAMES;
+        REQUIRE(real == plain.get_bus()->get_ppu()->get_state().FRAMES);
+        REQUIRE(ahead_out.numbers.back() == real + frames);
+        plain_frames.push_back(std::make_unique<Frame>(*plain_out.last));
+        ahead_frames.push_back(std::make_unique<Frame>(*ahead_out.last));
+    }
+    REQUIRE(ahead_out.numbers.size() == 6);
+
+    // What was presented is what the real run showed the given number of frames later
+    for (size_t i = 0; i + frames < plain_frames.size(); i++) {
+        REQUIRE(std::memcmp(ahead_frames[i]->pixels, plain_frames[i + frames]->pixels, sizeof(Frame::pixels)) == 0);
+    }
+    REQUIRE(std::memcmp(plain_frames[0]->pixels, plain_frames[1]->pixels, sizeof(Frame::pixels)) != 0);
+
+    // Machine state and audio are exactly those of the plain run. The state structs have
+    // padding, so they are compared field by field rather than as snapshots
+    REQUIRE(hash_machine(plain) == hash_machine(ahead));
+    const PPUState &plain_ppu = plain.get_bus()->get_ppu()->get_state();
+    const PPUState &ahead_ppu = ahead.get_bus()->get_ppu()->get_state();
+    REQUIRE(plain_ppu.LY == ahead_ppu.LY);
+    REQUIRE(plain_ppu.MODE == ahead_ppu.MODE);
+    REQUIRE(plain_ppu.BGP == ahead_ppu.BGP);
+    const APUState &plain_apu = plain.get_bus()->get_apu()->get_state();
+    const APUState &ahead_apu = ahead.get_bus()->get_apu()->get_state();
+    REQUIRE(plain_apu.TIME == ahead_apu.TIME);
+    REQUIRE(plain_apu.SEQUENCER_STEP == ahead_apu.SEQUENCER_STEP);
+    for (int c = 0; c < 4; c++) {
+        REQUIRE(plain_apu.CH[c].NEXT_EDGE == ahead_apu.CH[c].NEXT_EDGE);
+        REQUIRE(plain_apu.CH[c].POSITION == ahead_apu.CH[c].POSITION);
+    }
+    REQUIRE(plain.get_bus()->read_n8(0xFF05) == ahead.get_bus()->read_n8(0xFF05));
+    REQUIRE(plain_out.samples.size() > 0);
+    REQUIRE(ahead_out.samples == plain_out.samples);
+    REQUIRE(run_ahead.get_stats().FRAMES == 6);
+}
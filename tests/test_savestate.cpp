@@ -0,0 +1,117 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include "cpu.h"
+#include "savestate.h"
+#include "test_programs.h"
+
+TEST_CASE("A savestate file restores the machine it was saved from", "[savestate]") {
+    std::string path = temp_path("gameboy_test_state.gbs");
+    CPU source;
+    boot_counter(source);
+    fill_ram(source);
+    run(source, 30000);
+    REQUIRE(save_state(path, *source.get_bus()));
+
+    std::vector<uint8_t> bytes = read_file(path);
+    REQUIRE(bytes.size() % SAVESTATE_PAGE_SIZE == 0);
+    const SavestateHeader *header = reinterpret_cast<const SavestateHeader *>(bytes.data());
+    REQUIRE(header->FILE_SIZE == bytes.size());
+    REQUIRE(header->MCYCLES == source.get_state().MCYCLES);
+
+    Savestate state;
+    REQUIRE(state.open(path));
+    CPU copy;
+    copy.get_bus()->get_cartridge()->load(const_cast<uint8_t *>(COUNTER_PROGRAM), sizeof(COUNTER_PROGRAM));
+    for (int round = 0; round < 2; round++) {
+        REQUIRE(state.restore(*copy.get_bus()));
+        auto expected = std::make_unique<Snapshot>();
+        auto actual = std::make_unique<Snapshot>();
+        source.get_bus()->save_snapshot(*expected);
+        copy.get_bus()->save_snapshot(*actual);
+        REQUIRE(std::memcmp(expected.get(), actual.get(), sizeof(Snapshot)) == 0);
+        run(copy, 1000);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Savestates tolerate newer and older section layouts", "[savestate]") {
+    std::string path = temp_path("gameboy_test_state_compat.gbs");
+    CPU source;
+    boot_counter(source);
+    fill_ram(source);
+    source.get_bus()->get_timer()->get_state().RELOAD_TIME = 1234;
+    REQUIRE(save_state(path, *source.get_bus()));
+    std::vector<uint8_t> bytes = read_file(path);
+    SavestateHeader *header = reinterpret_cast<SavestateHeader *>(bytes.data());
+    SavestateSection *table = reinterpret_cast<SavestateSection *>(header + 1);
+
+    // A writer from the future: an unknown section and a WRAM section with a field appended
+    bytes.resize(bytes.size() + SAVESTATE_PAGE_SIZE, 0xAB);
+    header = reinterpret_cast<SavestateHeader *>(bytes.data());
+    table = reinterpret_cast<SavestateSection *>(header + 1);
+    table[header->SECTION_COUNT] = SavestateSection { section_id("NEW!"), 1, header->FILE_SIZE, 16 };
+    header->SECTION_COUNT++;
+    header->FILE_SIZE = bytes.size();
+    for (uint32_t i = 0; i < header->SECTION_COUNT; i++) {
+        if (table[i].ID == section_id("WRAM")) {
+            table[i].VERSION = 2;
+            table[i].SIZE += 32;
+        }
+    }
+    write_file(path, bytes);
+
+    CPU copy;
+    Savestate state;
+    REQUIRE(state.open(path));
+    REQUIRE(state.restore(*copy.get_bus()));
+    REQUIRE(copy.get_bus()->read_n8(0xC007) == 7);
+    REQUIRE(copy.get_bus()->get_timer()->get_state().RELOAD_TIME == 1234);
+    state.close();
+
+    // A writer from the past: the timer section ends before RELOAD_TIME, no serial section
+    for (uint32_t i = 0; i < header->SECTION_COUNT; i++) {
+        if (table[i].ID == section_id("TIMR")) {
+            table[i].SIZE = offsetof(TimerState, RELOAD_TIME);
+        } else if (table[i].ID == section_id("SERL")) {
+            table[i].ID = section_id("OLD!");
+        }
+    }
+    write_file(path, bytes);
+    copy.get_bus()->get_serial()->get_state().SB = 0x55;
+    REQUIRE(state.open(path));
+    REQUIRE(state.restore(*copy.get_bus()));
+    REQUIRE(copy.get_bus()->get_timer()->get_state().RELOAD_TIME == NEVER);
+    REQUIRE(copy.get_bus()->get_serial()->get_state().SB == 0);
+    REQUIRE(copy.get_bus()->read_n8(0xA007) == uint8_t(~7));
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Damaged savestates are rejected", "[savestate]") {
+    std::string path = temp_path("gameboy_test_state_bad.gbs");
+    CPU source;
+    REQUIRE(save_state(path, *source.get_bus()));
+    std::vector<uint8_t> bytes = read_file(path);
+    Savestate state;
+
+    std::vector<uint8_t> bad = bytes;
+    bad[0] = 'X';
+    write_file(path, bad);
+    REQUIRE_FALSE(state.open(path));
+    REQUIRE_FALSE(state.restore(*source.get_bus()));
+
+    bad = bytes;
+    reinterpret_cast<SavestateSection *>(bad.data() + sizeof(SavestateHeader))[3].OFFSET += 1;
+    write_file(path, bad);
+    REQUIRE_FALSE(state.open(path));
+
+    bad = bytes;
+    bad.resize(bad.size() - SAVESTATE_PAGE_SIZE);
+    write_file(path, bad);
+    REQUIRE_FALSE(state.open(path));
+
+    std::filesystem::remove(path);
+    REQUIRE_FALSE(state.open(path));
+}
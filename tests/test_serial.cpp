@@ -0,0 +1,125 @@
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+#include <vector>
+#include "cpu.h"
+#include "test_monitor.h"
+
+/* Runs the machine clock forward without executing instructions. */
+static void advance(CPU &cpu, uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; i++) {
+        cpu.get_state().MCYCLES++;
+        cpu.get_bus()->tick();
+    }
+}
+
+/* Runs until SC bit 7 clears or @limit cycles pass, returning the M-cycle it cleared at. */
+static uint64_t run_transfer(CPU &cpu, uint64_t limit) {
+    Bus *bus = cpu.get_bus();
+    for (uint64_t i = 0; i < limit && (bus->read_n8(0xFF02) & 0x80); i++) {
+        advance(cpu, 1);
+    }
+    return cpu.get_state().MCYCLES;
+}
+
+TEST_CASE("Serial transfer without a link reads 0xFF", "[serial]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+
+    bus->write_n8(0xFF01, 0x42);
+    bus->write_n8(0xFF02, 0x81);
+    REQUIRE(bus->read_n8(0xFF02) == 0xFF);
+    uint64_t start = cpu.get_state().MCYCLES;
+    REQUIRE(run_transfer(cpu, 5000) == start + SERIAL_TRANSFER_CYCLES);
+    REQUIRE(bus->read_n8(0xFF01) == 0xFF);
+    REQUIRE(bus->read_n8(0xFF02) == 0x7F);
+    REQUIRE((bus->read_n8(0xFF0F) & 0x08) == 0x08);
+
+    bus->write_n8(0xFF02, 0x80);  // External clock: nobody drives it
+    REQUIRE(run_transfer(cpu, 5000) == start + SERIAL_TRANSFER_CYCLES + 5000);
+}
+
+/* The master sends 0, 1, 2, ... after idling a varying time; the slave echoes each byte + 100. */
+static void run_side(CPU &cpu, LinkPort *port, bool master, std::vector<uint8_t> &received,
+                     std::vector<uint64_t> &completed) {
+    Bus *bus = cpu.get_bus();
+    bus->get_serial()->set_link(port, cpu.get_state().MCYCLES);
+    uint8_t next = 100;
+    for (int i = 0; i < 50; i++) {
+        if (master) {
+            advance(cpu, 300 + (i * 977) % 4000);
+            bus->write_n8(0xFF01, (uint8_t)i);
+            bus->write_n8(0xFF02, 0x81);
+        } else {
+            advance(cpu, (i * 131) % 700);
+            bus->write_n8(0xFF01, next);
+            bus->write_n8(0xFF02, 0x80);
+        }
+        completed.push_back(run_transfer(cpu, 100000));
+        received.push_back(bus->read_n8(0xFF01));
+        next = received.back() + 100;
+    }
+    bus->get_serial()->set_link(nullptr, cpu.get_state().MCYCLES);
+}
+
+TEST_CASE("Link cable couples two instances on separate threads", "[serial]") {
+    LinkCable cable;
+    CPU master;
+    CPU slave;
+    std::vector<uint8_t> master_received, slave_received;
+    std::vector<uint64_t> master_completed, slave_completed;
+
+    std::thread thread([&]() {
+        run_side(slave, cable.get_port(1), false, slave_received, slave_completed);
+    });
+    run_side(master, cable.get_port(0), true, master_received, master_completed);
+    thread.join();
+
+    REQUIRE(master_completed == slave_completed);
+    for (int i = 0; i < 50; i++) {
+        REQUIRE(slave_received[i] == i);
+        REQUIRE(master_received[i] == (uint8_t)((i == 0 ? 0 : i - 1) + 100));
+    }
+}
+
+TEST_CASE("TestMonitor detects serial verdicts", "[serial]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    TestMonitor monitor;
+    monitor.attach(cpu);
+
+    auto print = [&](const char *text) {
+        for (const char *c = text; *c; c++) {
+            bus->write_n8(0xFF01, (uint8_t)*c);
+            bus->write_n8(0xFF02, 0x81);
+            advance(cpu, SERIAL_TRANSFER_CYCLES);
+        }
+    };
+    print("cpu_instrs\n\n01:ok  02:ok\n\nPasse");
+    REQUIRE(monitor.get_result() == TestResult::RUNNING);
+    print("d all tests\n");
+    REQUIRE(monitor.get_result() == TestResult::PASSED);
+    REQUIRE(monitor.get_output() == "cpu_instrs\n\n01:ok  02:ok\n\nPassed all tests\n");
+}
+
+TEST_CASE("TestMonitor detects LD B,B verdicts", "[serial]") {
+    for (bool pass : { true, false }) {
+        ROM *rom = new ROM();
+        uint8_t program[] = { 0x40, 0x40 };  // LD B,B twice
+        rom->load(program, sizeof(program));
+        CPU cpu(new Bus(rom));
+        cpu.reset();
+        TestMonitor monitor;
+        monitor.attach(cpu);
+
+        CPUState &state = cpu.get_state();
+        state.BC.r16 = 0x0102;  // Not a verdict: an ordinary breakpoint
+        cpu.step();
+        REQUIRE(monitor.get_result() == TestResult::RUNNING);
+
+        state.BC.r16 = pass ? 0x0305 : 0x4242;
+        state.DE.r16 = pass ? 0x080D : 0x4242;
+        state.HL.r16 = pass ? 0x1522 : 0x4242;
+        cpu.step();
+        REQUIRE(monitor.get_result() == (pass ? TestResult::PASSED : TestResult::FAILED));
+    }
+}
@@ -0,0 +1,107 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <memory>
+#include "cpu.h"
+#include "test_programs.h"
+
+TEST_CASE("Restoring a snapshot replays the machine exactly", "[snapshot]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    boot_counter(cpu);
+    auto start = std::make_unique<Snapshot>();
+    auto first = std::make_unique<Snapshot>();
+    auto second = std::make_unique<Snapshot>();
+
+    run(cpu, 5000);
+    bus->save_snapshot(*start);
+    bus->write_n8(0xCC00, 0x5A);
+    run(cpu, 20000);
+    bus->save_snapshot(*first);
+
+    bus->load_snapshot(*start);
+    REQUIRE(cpu.get_state().MCYCLES == start->CPU.MCYCLES);
+    REQUIRE(bus->read_n8(0xCC00) == 0x00);
+    bus->write_n8(0xCC00, 0x5A);
+    run(cpu, 20000);
+    bus->save_snapshot(*second);
+
+    REQUIRE(std::memcmp(first.get(), second.get(), sizeof(Snapshot)) == 0);
+    REQUIRE(second->PPU.FRAMES > 0);
+    REQUIRE(second->TIMER.TAC == 0x05);
+    REQUIRE(second->HRAM[0] != start->HRAM[0]);
+}
+
+TEST_CASE("A snapshot moves a machine into another instance", "[snapshot]") {
+    CPU source;
+    boot_counter(source);
+    run(source, 3000);
+    auto snapshot = std::make_unique<Snapshot>();
+    source.get_bus()->save_snapshot(*snapshot);
+
+    CPU copy;
+    copy.get_bus()->get_cartridge()->load(const_cast<uint8_t *>(COUNTER_PROGRAM), sizeof(COUNTER_PROGRAM));
+    copy.get_bus()->load_snapshot(*snapshot);
+
+    run(source, 1000);
+    run(copy, 1000);
+    REQUIRE(std::memcmp(&source.get_state(), &copy.get_state(), sizeof(CPUState)) == 0);
+    REQUIRE(std::memcmp(source.get_bus()->get_wram()->data(), copy.get_bus()->get_wram()->data(), 0x2000) == 0);
+    REQUIRE(source.get_bus()->read_n8(0xFF44) == copy.get_bus()->read_n8(0xFF44));
+}
+
+TEST_CASE("Bus writes mark their 256-byte pages dirty", "[snapshot]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    auto snapshot = std::make_unique<Snapshot>();
+    bus->save_snapshot(*snapshot);
+
+    bus->write_n8(0xC012, 1);
+    bus->write_n8(0xE345, 1);       // Echo of WRAM page 3
+    bus->write_n8(0x9F00, 1);
+    bus->write_n8(0xA100, 1);
+    bus->write_n8(0xFF90, 1);
+    bus->write_n8(0xFF40, 0x80);    // Registers are always copied
+    const DirtyPages &dirty = bus->get_dirty_pages();
+    REQUIRE(dirty.WRAM == 0x00000009);
+    REQUIRE(dirty.VRAM == 0x80000000);
+    REQUIRE(dirty.ERAM == 0x00000002);
+    REQUIRE(dirty.HRAM == 1);
+
+    bus->update_snapshot(*snapshot);
+    REQUIRE(dirty.WRAM == 0);
+    REQUIRE(dirty.HRAM == 0);
+}
+
+TEST_CASE("Updating a snapshot copies only dirty pages", "[snapshot]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    bus->get_dma()->set_cgb_mode(true);
+    boot_counter(cpu);
+    auto incremental = std::make_unique<Snapshot>();
+    auto full = std::make_unique<Snapshot>();
+    auto copy = std::make_unique<Snapshot>();
+    bus->save_snapshot(*incremental);
+
+    for (int frame = 0; frame < 4; frame++) {
+        run(cpu, 2000);
+        bus->write_n8(0xC000 + frame * 0x321, frame);
+        bus->write_n8(0xA000 + frame * 0x111, frame);
+        bus->write_n8(0xFF51, 0xC0);
+        bus->write_n8(0xFF52, 0x00);
+        bus->write_n8(0xFF53, frame);
+        bus->write_n8(0xFF54, 0x00);
+        bus->write_n8(0xFF55, 0x0F);    // 256 bytes of WRAM into VRAM behind the bus
+        bus->update_snapshot(*incremental);
+        std::memcpy(copy.get(), incremental.get(), sizeof(Snapshot));
+        bus->save_snapshot(*full);
+        REQUIRE(std::memcmp(copy.get(), full.get(), sizeof(Snapshot)) == 0);
+        bus->update_snapshot(*incremental);     // Not the last one saved, so copied in full
+    }
+
+    // A page nobody wrote is left alone
+    incremental->WRAM[0x1F00] = 0xEE;
+    bus->write_n8(0xC000, 0x42);
+    bus->update_snapshot(*incremental);
+    REQUIRE(incremental->WRAM[0x0000] == 0x42);
+    REQUIRE(incremental->WRAM[0x1F00] == 0xEE);
+}
@@ -0,0 +1,95 @@
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "hash.h"
+#include "run_ahead.h"
+#include "test_programs.h"
+
+static uint8_t input(uint32_t frame) { return frame % 3 ? BUTTON_UP << (frame % 5) : 0; }
+
+static uint64_t full_hash(CPU &cpu) {
+    StateHasher fresh;
+    return fresh.update(*cpu.get_bus());
+}
+
+TEST_CASE("The incremental state hash matches hashing everything", "[state_hash]") {
+    CPU cpu;
+    boot_joypad(cpu);
+    Bus *bus = cpu.get_bus();
+    StateHasher hasher;
+    std::vector<uint64_t> hashes;
+    Snapshot snapshot;
+
+    for (uint32_t frame = 0; frame < 12; frame++) {
+        bus->set_buttons(input(frame));
+        run_to_frame_end(cpu);
+        if (frame == 4) {
+            bus->save_snapshot(snapshot);
+        }
+        // Writes that bypass the CPU: OAM DMA from WRAM and a VRAM block marked by hand
+        if (frame == 6) {
+            bus->write_n8(0xFF46, 0xC0);
+            std::memset(bus->get_vram()->data() + 0x1234, 0x5A, 0x300);
+            bus->mark_dirty(0x9234, 0x300);
+        }
+        hashes.push_back(hasher.update(*bus));
+        REQUIRE(hashes.back() == full_hash(cpu));
+    }
+    REQUIRE(hashes[10] != hashes[11]);
+
+    // A restore, full or from the dirty pages, rehashes whatever it changed
+    bus->revert_snapshot(snapshot);
+    REQUIRE(hasher.update(*bus) == hashes[4]);
+    bus->set_buttons(input(5));
+    run_to_frame_end(cpu);
+    REQUIRE(hasher.update(*bus) == hashes[5]);
+    bus->load_snapshot(snapshot);
+    REQUIRE(hasher.update(*bus) == hashes[4]);
+
+    // Every part of the state counts, RAM and subsystem registers alike
+    bus->write_n8(0xFF06, 0x42);    // TMA
+    uint64_t timer_changed = hasher.update(*bus);
+    REQUIRE(timer_changed != hashes[4]);
+    bus->write_n8(0xA000 + 0x1FFF, 0x01);
+    REQUIRE(hasher.update(*bus) != timer_changed);
+    REQUIRE(hasher.update(*bus) == full_hash(cpu));
+}
+
+TEST_CASE("Machines run on different threads hash alike", "[state_hash]") {
+    const int machines = 3;
+    std::vector<std::vector<uint64_t>> hashes(machines);
+    std::vector<std::unique_ptr<Snapshot>> finals;
+    for (int i = 0; i < machines; i++) {
+        finals.push_back(std::make_unique<Snapshot>());
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < machines; i++) {
+        threads.emplace_back([i, &hashes, &finals] {
+            // Garbage in the heap where the machine is built must not leak into the hash
+            std::unique_ptr<uint8_t[]> scribble(new uint8_t[1 << 20]);
+            std::memset(scribble.get(), 0xA5 + i, 1 << 20);
+            scribble.reset();
+
+            auto cpu = std::make_unique<CPU>();
+            boot_joypad(*cpu);
+            StateHasher hasher;
+            for (uint32_t frame = 0; frame < 20; frame++) {
+                cpu->get_bus()->set_buttons(input(frame));
+                run_to_frame_end(*cpu);
+                hashes[i].push_back(hasher.update(*cpu->get_bus()));
+            }
+            cpu->get_bus()->save_snapshot(*finals[i]);
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (int i = 1; i < machines; i++) {
+        REQUIRE(hashes[i] == hashes[0]);
+        REQUIRE(std::memcmp(finals[i].get(), finals[0].get(), sizeof(Snapshot)) == 0);
+    }
+}
@@ -0,0 +1,150 @@
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+#include "cpu.h"
+
+/* Runs the machine clock forward without executing instructions. */
+static void advance(CPU &cpu, uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; i++) {
+        cpu.get_state().MCYCLES++;
+        cpu.get_bus()->tick();
+    }
+}
+
+/* Per-cycle reference: a real 16-bit counter with a falling-edge detector on every step. */
+struct NaiveTimer {
+    uint16_t counter = 0;
+    uint16_t tima = 0;
+    uint8_t  tma = 0;
+    uint8_t  tac = 0;
+    uint8_t  interrupt_flags = 0;
+    bool     pending = false;
+    bool     reloaded = false;
+
+    bool signal() const {
+        static const uint16_t periods[4] = { 1024, 16, 64, 256 };
+        return (tac & 0x04) && (counter & (periods[tac & 3] / 2));
+    }
+    void increment() {
+        if (!pending && ++tima == 0x100) {
+            tima = 0;
+            pending = true;
+        }
+    }
+    void step() {
+        reloaded = false;
+        if (pending) {
+            tima = tma;
+            interrupt_flags |= 0x04;
+            pending = false;
+            reloaded = true;
+        }
+        bool before = signal();
+        counter += 4;
+        if (before && !signal()) {
+            increment();
+        }
+    }
+    void write(uint16_t address, uint8_t data) {
+        bool before = signal();
+        switch (address) {
+            case 0xFF04:
+                counter = 0;
+                if (before) {
+                    increment();
+                }
+                break;
+            case 0xFF05:
+                if (!reloaded) {
+                    tima = data;
+                    pending = false;
+                }
+                break;
+            case 0xFF06:
+                tma = data;
+                if (reloaded) {
+                    tima = data;
+                }
+                break;
+            default:
+                tac = data & 0x07;
+                if (before && !signal()) {
+                    increment();
+                }
+                break;
+        }
+    }
+};
+
+TEST_CASE("Timer DIV and TIMA follow the cycle counter", "[timer]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+
+    advance(cpu, 64 * 3 + 10);
+    REQUIRE(bus->read_n8(0xFF04) == 3);
+
+    bus->write_n8(0xFF04, 0x12);  // Any write resets DIV
+    REQUIRE(bus->read_n8(0xFF04) == 0);
+    advance(cpu, 64);
+    REQUIRE(bus->read_n8(0xFF04) == 1);
+
+    bus->write_n8(0xFF06, 0xF0);
+    bus->write_n8(0xFF05, 0xFE);
+    bus->write_n8(0xFF07, 0x05);  // 262144 Hz: every 4 M-cycles
+    REQUIRE(bus->read_n8(0xFF07) == 0xFD);
+    bus->write_n8(0xFF0F, 0x00);
+    REQUIRE(bus->get_scheduler()->when(Event::TIMER) != NEVER);
+
+    advance(cpu, 4);
+    REQUIRE(bus->read_n8(0xFF05) == 0xFF);
+    advance(cpu, 4);
+    REQUIRE(bus->read_n8(0xFF05) == 0x00);  // Overflowed, reload still pending
+    REQUIRE((bus->read_n8(0xFF0F) & 0x04) == 0);
+    advance(cpu, 1);
+    REQUIRE(bus->read_n8(0xFF05) == 0xF0);
+    REQUIRE((bus->read_n8(0xFF0F) & 0x04) == 0x04);
+}
+
+TEST_CASE("Timer DIV reset and TAC change glitches", "[timer]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+
+    bus->write_n8(0xFF07, 0x05);  // Bit 3 of the counter: set for the 2nd half of 4 M-cycles
+    advance(cpu, 2);
+    REQUIRE(bus->read_n8(0xFF05) == 0);
+    bus->write_n8(0xFF04, 0);     // Bit 3 falls: one extra increment
+    REQUIRE(bus->read_n8(0xFF05) == 1);
+
+    advance(cpu, 2);
+    bus->write_n8(0xFF07, 0x04);  // Switch to bit 9, which is clear
+    REQUIRE(bus->read_n8(0xFF05) == 2);
+    bus->write_n8(0xFF07, 0x00);  // Bit 9 was already clear: no increment
+    REQUIRE(bus->read_n8(0xFF05) == 2);
+}
+
+TEST_CASE("Lazy timer matches a per-cycle timer", "[timer]") {
+    CPU cpu;
+    Bus *bus = cpu.get_bus();
+    NaiveTimer naive;
+    std::mt19937 rng(36);
+    static const uint16_t registers[4] = { 0xFF04, 0xFF05, 0xFF06, 0xFF07 };
+
+    for (int op = 0; op < 20000; op++) {
+        uint64_t cycles = (rng() % 4 == 0) ? rng() % 600 : rng() % 6;
+        for (uint64_t i = 0; i < cycles; i++) {
+            naive.step();
+        }
+        advance(cpu, cycles);
+
+        uint16_t address = registers[rng() % 4];
+        uint8_t data = (address == 0xFF07) ? (rng() & 0x07) : (uint8_t)(0xF0 + rng() % 16);
+        bus->write_n8(address, data);
+        naive.write(address, data);
+
+        REQUIRE(bus->read_n8(0xFF04) == (naive.counter >> 8));
+        REQUIRE(bus->read_n8(0xFF05) == naive.tima);
+        REQUIRE(bus->read_n8(0xFF06) == naive.tma);
+        REQUIRE((bus->read_n8(0xFF0F) & 0x04) == naive.interrupt_flags);
+        bus->write_n8(0xFF0F, 0x00);
+        naive.interrupt_flags = 0;
+    }
+}
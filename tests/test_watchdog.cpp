@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+#include "cpu.h"
+#include "rewind.h"
+
+/* Boots a CPU on a ROM holding @program at address 0. */
+static CPU *boot(std::initializer_list<uint8_t> program) {
+    static uint8_t bytes[0x100];
+    std::fill(std::begin(bytes), std::end(bytes), 0);
+    std::copy(program.begin(), program.end(), bytes);
+    ROM *rom = new ROM();
+    rom->load(bytes, sizeof(bytes));
+    CPU *cpu = new CPU(new Bus(rom));
+    cpu->reset();
+    cpu->get_state().SP.r16 = 0xFFFE;
+    return cpu;
+}
+
+static void run(CPU &cpu, int steps) {
+    for (int i = 0; i < steps && !cpu.get_stuck_reason(); i++) {
+        cpu.step();
+    }
+}
+
+TEST_CASE("Watchdog catches JR to itself with interrupts disabled", "[watchdog]") {
+    std::unique_ptr<CPU> cpu(boot({ 0x00, 0x18, 0xFE }));  // NOP; JR -2
+    run(*cpu, 100);
+    REQUIRE(cpu->get_stuck_reason() != nullptr);
+    REQUIRE(cpu->get_state().PC.r16 == 0x0001);
+
+    /* With an interrupt that can fire the same loop is a normal wait */
+    std::unique_ptr<CPU> waiting(boot({ 0x00, 0x18, 0xFE }));
+    waiting->get_state().IME = 1;
+    waiting->get_state().IE = 0x01;
+    run(*waiting, 100);
+    REQUIRE(waiting->get_stuck_reason() == nullptr);
+
+    /* IE bits above the five interrupts enable nothing */
+    std::unique_ptr<CPU> unmasked(boot({ 0x00, 0x18, 0xFE }));
+    unmasked->get_state().IME = 1;
+    unmasked->get_state().IE = 0xE0;
+    run(*unmasked, 100);
+    REQUIRE(unmasked->get_stuck_reason() != nullptr);
+}
+
+TEST_CASE("Watchdog catches HALT that can never wake", "[watchdog]") {
+    std::unique_ptr<CPU> cpu(boot({ 0x76 }));  // HALT
+    run(*cpu, 10);
+    REQUIRE(cpu->get_stuck_reason() != nullptr);
+}
+
+TEST_CASE("Restoring a state from before a hang clears the verdict", "[watchdog]") {
+    std::unique_ptr<CPU> cpu(boot({ 0x00, 0x18, 0xFE }));  // NOP; JR -2
+    Bus *bus = cpu->get_bus();
+    Snapshot before;
+    bus->save_snapshot(before);
+    Rewind rewind(1 << 20, 1, 4);
+    rewind.push(before);
+
+    run(*cpu, 100);
+    REQUIRE(cpu->get_stuck_reason() != nullptr);
+    bus->load_snapshot(before);
+    REQUIRE(cpu->get_stuck_reason() == nullptr);
+
+    run(*cpu, 100);
+    REQUIRE(cpu->get_stuck_reason() != nullptr);
+    REQUIRE(rewind.rewind(*bus));
+    REQUIRE(cpu->get_stuck_reason() == nullptr);
+    REQUIRE(cpu->get_state().PC.r16 == 0x0000);
+}
+
+TEST_CASE("HALT wakes on an enabled interrupt and dispatches it", "[watchdog]") {
+    std::unique_ptr<CPU> cpu(boot({ 0x76, 0x00 }));  // HALT; NOP
+    Bus *bus = cpu->get_bus();
+    CPUState &state = cpu->get_state();
+    state.IME = 1;
+    bus->write_n8(0xFFFF, 0x04);  // Timer interrupt
+    bus->write_n8(0xFF07, 0x05);  // TIMA every 4 M-cycles from 0: overflows at 1024
+
+    cpu->step();
+    REQUIRE(state.HALTED == 1);
+    while (state.PC.r16 != 0x50) {
+        REQUIRE(state.MCYCLES < 2000);
+        cpu->step();
+    }
+    REQUIRE(cpu->get_stuck_reason() == nullptr);
+    REQUIRE(state.HALTED == 0);
+    REQUIRE(state.IME == 0);
+    REQUIRE((state.IF & 0x04) == 0);
+    REQUIRE(bus->read_n16(state.SP.r16) == 0x0001);
+    REQUIRE(state.MCYCLES == 1026);  // IF is raised at 1025, dispatch starts on the next cycle
+}